@@ -11,6 +11,19 @@
 #include "Space3D.hpp"
 #include "Viewer.hpp"
 #include "Space3DUnrealSource.h"
+#include "Space3DUnrealRenderWorker.h"
+#include "Space3DUnrealFrameQueue.h"
+#include "Space3DUnrealInputFifo.h"
+#include "Space3DUnrealResampler.h"
+#include "Space3DUnrealGovernor.h"
+#include "Space3DUnrealDryPath.h"
+#include "Space3DUnrealSubsystem.h"
+#include "Space3DUnrealCommandBuffer.h"
+#include "Space3DUnrealHMDTracker.h"
+#include "Space3DUnrealClock.h"
+#include "Space3DUnrealTrajectories.h"
+#include "Space3DUnrealPredictor.h"
+#include "Space3DUnrealMeshLoader.h"
 
 DEFINE_LOG_CATEGORY(LogSpace3DUnreal)
 
@@ -25,16 +38,259 @@ namespace Space3DUnreal {
   float GetScaleFactor() { return ScaleFactor; }
   void SetScaleFactor(float Scale) { ScaleFactor = Scale; }
   
-  static std::atomic<uint32_t> NumBuffersAvailable;
-  
-  void SetOutputAudioAvailable() { ++NumBuffersAvailable; }
-  uint32_t GetAndConsumeOutputAudio() { return NumBuffersAvailable.exchange(0); }
-  
   static std::atomic<uint64_t> AudioT;
   
   void SetAudioT(uint64_t t) { AudioT.store(t, std::memory_order_relaxed); }
   uint64_t GetAudioT() { return AudioT.load(std::memory_order_relaxed); }
   
+  static FSpace3DUnrealClock Clock;
+  
+  FSpace3DUnrealClock& GetClock() { return Clock; }
+  
+  static std::atomic<uint64_t> NsPerBuffer(1024ull * 1000000000ull / 48000ull);
+  
+  void SetNsPerBuffer(uint64_t Ns) { NsPerBuffer.store(Ns, std::memory_order_relaxed); }
+  uint64_t GetNsPerBuffer() { return NsPerBuffer.load(std::memory_order_relaxed); }
+  
+  static std::atomic<int32> FrameLengthConfig(0);
+  
+  void SetFrameLengthConfig(int32 FrameLength) { FrameLengthConfig.store(FrameLength); }
+  int32 GetFrameLengthConfig() { return FrameLengthConfig.load(); }
+  
+  static std::atomic<int32> InternalSampleRateConfig(0);
+  
+  void SetInternalSampleRateConfig(int32 SampleRate) { InternalSampleRateConfig.store(SampleRate); }
+  int32 GetInternalSampleRateConfig() { return InternalSampleRateConfig.load(); }
+  
+  static FSpace3DUnrealInputFifo InputFifo;
+  static FSpace3DUnrealFrameQueue FrameQueue;
+  
+  FSpace3DUnrealInputFifo& GetInputFifo() { return InputFifo; }
+  FSpace3DUnrealFrameQueue& GetFrameQueue() { return FrameQueue; }
+  
+  static FSpace3DUnrealGovernor Governor;
+  
+  FSpace3DUnrealGovernor& GetGovernor() { return Governor; }
+  
+  static FSpace3DUnrealDryPath DryPath;
+  
+  FSpace3DUnrealDryPath& GetDryPath() { return DryPath; }
+  
+  static FSpace3DUnrealCommandBuffer Commands;
+  
+  FSpace3DUnrealCommandBuffer& GetCommands() { return Commands; }
+  
+  static FSpace3DUnrealHMDTracker HMDTracker;
+  
+  FSpace3DUnrealHMDTracker& GetHMDTracker() { return HMDTracker; }
+  
+  static std::atomic<uint64_t> ProcessT(0);
+  
+  uint64_t GetProcessT() { return ProcessT.load(std::memory_order_relaxed); }
+  
+  static FSpace3DUnrealTrajectories Trajectories;
+  
+  FSpace3DUnrealTrajectories& GetTrajectories() { return Trajectories; }
+  
+  static FSpace3DUnrealPredictor Predictor;
+  
+  FSpace3DUnrealPredictor& GetPredictor() { return Predictor; }
+  
+  static FSpace3DUnrealMeshLoader MeshLoader;
+  
+  FSpace3DUnrealMeshLoader& GetMeshLoader() { return MeshLoader; }
+  
+  //Space3D's physics callback, within each Process: everything posed on the audio side
+  static void OnPhysCallback()
+  {
+    uint64_t T = ProcessT.load(std::memory_order_relaxed);
+    Predictor.ApplyToObjects(T);
+    HMDTracker.ApplyToHead(T);
+    Trajectories.ApplyToObjects(T);
+  }
+  
+  //Start of the Process call in flight (0 = none), for the dry path's watchdog
+  static std::atomic<uint64> ProcessStartCycles(0);
+  static std::atomic<double> FrameSeconds(1024.0 / 48000.0);
+  
+  float GetProcessInFlightFrames()
+  {
+    uint64 Start = ProcessStartCycles.load(std::memory_order_relaxed);
+    if(Start == 0) return 0.0f;
+    double Seconds = (double)(FPlatformTime::Cycles64() - Start) * FPlatformTime::GetSecondsPerCycle64();
+    return (float)(Seconds / FrameSeconds.load(std::memory_order_relaxed));
+  }
+  
+  //Space3D output at the internal rate, and one resampler history per output channel
+  static FSpace3DUnrealResampler OutputResampler;
+  static TArray<float> OutputScratch;
+  static TArray<TArray<float>> OutputHistories;
+  
+  //Space3D sources for the spatializer's slots, as applied from the input FIFO by whoever runs Space3D
+  static TArray<uint64_t> SourceKeys;
+  static TArray<uint64_t> SourceUuids;
+  
+  void RemoveSources()
+  {
+    for(int32 i=0; i<SourceUuids.Num(); ++i)
+    {
+      if(SourceUuids[i] != 0) Space3D::SourceRemove(SourceUuids[i]);
+      SourceUuids[i] = SourceKeys[i] = 0;
+    }
+  }
+  
+  //Holding the API lock
+  static void ApplySourceState(int32 Slot, const FSpace3DUnrealSourceState& State)
+  {
+    uint64_t& uuid = SourceUuids[Slot];
+    if(State.Key != SourceKeys[Slot])
+    {
+      if(uuid != 0) Space3D::SourceRemove(uuid);
+      uuid = State.Key != 0 ? Space3D::SourceAdd() : 0;
+      SourceKeys[Slot] = State.Key;
+      if(uuid != 0 && State.bHasSettings)
+      {
+        Space3D::SourceSetVolume(uuid, (audiofloat)State.Volume);
+        Space3D::SourceSetDir(uuid, static_cast<Space3D::DirType>(State.DirType), State.DirBeamWidth, State.DirCosMixFactor, State.DirUnused);
+        Space3D::SourceSetThresholds(uuid, State.ThresholdFull, State.ThresholdZero);
+      }
+    }
+    if(uuid != 0 && State.bMoved) Space3D::PhysUpdate(uuid, State.T, U2GV(State.Position), U2GQ(State.Rotation));
+  }
+  
+  void ConfigureRendering(int32 NumSlots, int32 MaxPushLength, int32 FrameLength, float InternalRate, int32 BufferLength, float DeviceRate)
+  {
+    int32 NumChannels = (int32)Space3D::OutputChannelCount();
+    //Whatever was queued is gone; the next push brings every source back
+    RemoveSources();
+    SourceKeys.Empty();
+    SourceKeys.SetNumZeroed(NumSlots);
+    SourceUuids.Empty();
+    SourceUuids.SetNumZeroed(NumSlots);
+    InputFifo.Configure(NumSlots, MaxPushLength, FrameLength, InternalRate);
+    OutputResampler.Configure(InternalRate, DeviceRate, FrameLength);
+    OutputScratch.Empty();
+    OutputHistories.Empty();
+    if(OutputResampler.IsActive())
+    {
+      OutputScratch.SetNumZeroed(NumChannels * FrameLength);
+      OutputHistories.AddDefaulted(NumChannels);
+      for(int32 c=0; c<NumChannels; ++c) OutputResampler.InitHistory(OutputHistories[c]);
+    }
+    FrameQueue.Configure(NumChannels, OutputResampler.MaxOutput(), BufferLength, OutputResampler.IsActive());
+    DryPath.Configure(NumSlots, BufferLength, DeviceRate, NumChannels);
+    FrameSeconds.store((double)FrameLength / (double)InternalRate);
+  }
+  
+  static std::atomic<int32> NumOutputChannelsPlayed(0);
+  
+  void SetNumOutputChannelsPlayed(int32 NumChannels) { NumOutputChannelsPlayed.store(NumChannels, std::memory_order_relaxed); }
+  
+  void ProcessFrame(uint64_t Seq, uint64_t T)
+  {
+    uint64 Start = FPlatformTime::Cycles64();
+    ProcessStartCycles.store(Start, std::memory_order_relaxed);
+    ProcessT.store(T, std::memory_order_relaxed);
+    Space3D::Process(T);
+    ProcessStartCycles.store(0, std::memory_order_relaxed);
+    double Elapsed = (double)(FPlatformTime::Cycles64() - Start) * FPlatformTime::GetSecondsPerCycle64();
+    Governor.OnFrameProcessed(Elapsed, (double)Space3D::FrameLength() / (double)Space3D::GetParams()->fs);
+    float* Audio = FrameQueue.BeginWrite();
+    if(Audio == nullptr) return;
+    int32 Length = FrameQueue.FrameLength();
+    int32 NumChannels = FrameQueue.NumChannels();
+    int32 Played = NumOutputChannelsPlayed.load(std::memory_order_relaxed);
+    if(Played > 0 && Played < NumChannels) NumChannels = Played;
+    if(!OutputResampler.IsActive())
+    {
+      //Read everything back in one lock hold, straight into the queue's preallocated planar frame
+      SPACE3D_RAII_LOCK_API;
+      for(int32 c=0; c<NumChannels; ++c)
+      {
+        Space3D::OutputChannelRead(c, (audiofloat*)(Audio + c * Length));
+      }
+      FrameQueue.EndWrite(Seq, T, Length);
+      return;
+    }
+    
+    int32 InternalLength = (int32)Space3D::FrameLength();
+    {
+      SPACE3D_RAII_LOCK_API;
+      for(int32 c=0; c<NumChannels; ++c)
+      {
+        Space3D::OutputChannelRead(c, (audiofloat*)(OutputScratch.GetData() + c * InternalLength));
+      }
+    }
+    int32 NumSamples = OutputResampler.NumOutputs(InternalLength);
+    for(int32 c=0; c<NumChannels; ++c)
+    {
+      OutputResampler.Process(OutputHistories[c], OutputScratch.GetData() + c * InternalLength, InternalLength, Audio + c * Length);
+    }
+    OutputResampler.Advance(InternalLength);
+    FrameQueue.EndWrite(Seq, T, NumSamples);
+  }
+  
+  void RenderFrames()
+  {
+    uint64_t Seq, T;
+    while(InputFifo.BeginPop(Seq, T))
+    {
+      {
+        SPACE3D_RAII_LOCK_API;
+        //Sources are added, removed and moved here, in step with their audio, rather than on the audio render thread
+        while(InputFifo.BeginApply())
+        {
+          for(int32 i=0; i<InputFifo.NumSlots(); ++i) ApplySourceState(i, InputFifo.State(i));
+          InputFifo.EndApply();
+        }
+        for(int32 i=0; i<InputFifo.NumSlots(); ++i)
+        {
+          //The slot may have moved on to another source since this frame was queued
+          uint64_t Key = InputFifo.Key(i);
+          if(Key != 0 && Key == SourceKeys[i] && SourceUuids[i] != 0) Space3D::SourceWrite(SourceUuids[i], (const audiofloat*)InputFifo.Frame(i));
+        }
+        DryPath.SnapshotSinks(T);
+      }
+      InputFifo.EndPop();
+      ProcessFrame(Seq, T);
+    }
+  }
+  
+  static std::atomic<bool> RenderWorkerEnabled(false);
+  static std::atomic<int32> RenderWorkerBuffers(2);
+  static FSpace3DUnrealRenderWorker* RenderWorker = nullptr;
+  
+  void SetRenderWorkerConfig(bool bEnable, int32 NumBuffers)
+  {
+    RenderWorkerBuffers.store(NumBuffers);
+    RenderWorkerEnabled.store(bEnable);
+  }
+  
+  FSpace3DUnrealRenderWorker* UpdateRenderWorker()
+  {
+    bool bWant = RenderWorkerEnabled.load();
+    if(RenderWorker != nullptr && !bWant)
+    {
+      StopRenderWorker();
+    }
+    else if(RenderWorker == nullptr && bWant)
+    {
+      RenderWorker = new FSpace3DUnrealRenderWorker();
+    }
+    int32 Backlog = RenderWorker != nullptr ? RenderWorkerBuffers.load() : 2;
+    InputFifo.SetMaxBacklog(Backlog);
+    FrameQueue.SetMaxBacklog(Backlog);
+    return RenderWorker;
+  }
+  
+  FSpace3DUnrealRenderWorker* GetRenderWorker() { return RenderWorker; }
+  
+  void StopRenderWorker()
+  {
+    delete RenderWorker;
+    RenderWorker = nullptr;
+  }
+  
   static FSpace3DUnrealSourceFactory* SourceFactory = nullptr;
   
   std::atomic_flag ViewerKeepRunningFlag;
@@ -163,8 +419,7 @@ void FSpace3DUnrealModule::StartupModule()
   
   Space3D::CoordinateSystem(Space3D::CoordAxis::PosY, Space3D::CoordAxis::PosX, Space3D::CoordAxis::PosZ);
   Space3D::OutputChannelsSet(AUDIO_MIXER_MAX_OUTPUT_CHANNELS);
-  
-  Space3DUnreal::NumBuffersAvailable.store(0);
+  Space3D::PhysRegisterCallback(&Space3DUnreal::OnPhysCallback);
   
   Space3DUnreal::SourceFactory = new FSpace3DUnrealSourceFactory();
   IModularFeatures::Get().RegisterModularFeature(Space3DUnreal::SourceFactory->GetModularFeatureName(), Space3DUnreal::SourceFactory);
@@ -189,6 +444,8 @@ void FSpace3DUnrealModule::ShutdownModule()
 
   if(!S3DLibraryHandle) return;
   Space3DUnreal::Active = false;
+  Space3DUnreal::StopRenderWorker();
+  Space3DUnreal::MeshLoader.Reset();
   
   // Close Viewer
   if (Space3DUnreal::ViewerThread != nullptr)
@@ -215,10 +472,21 @@ void FSpace3DUnrealModule::ShutdownModule()
 
 #define S3DUNREALCOMPONENTBUG UE_LOG(LogSpace3DUnreal, Error, TEXT("Improper use of USpace3DUnrealComponent / bug"))
 
-USpace3DUnrealComponent::USpace3DUnrealComponent(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer), uuid(0), IntentionallyNotCreated(false), LastT(0)
+USpace3DUnrealComponent::USpace3DUnrealComponent(const FObjectInitializer& ObjectInitializer)
+  : Super(ObjectInitializer)
+  , Motion(ESpace3DUnrealMotion::Auto)
+  , MotionPositionEpsilon(0.05f)
+  , MotionRotationEpsilon(0.05f)
+  , MotionScaleEpsilon(0.0001f)
+  , MotionUpdateInterval(0.0f)
+  , MotionPrediction(ESpace3DUnrealPrediction::None)
+  , uuid(0)
+  , IntentionallyNotCreated(false)
+  , AddTicket(0)
+  , bPosedByTrajectory(false)
 {
-  PrimaryComponentTick.bCanEverTick = true;
-  PrimaryComponentTick.SetTickFunctionEnable(true);
+  //Updated by USpace3DUnrealSubsystem
+  PrimaryComponentTick.bCanEverTick = false;
 }
 
 USpace3DUnrealComponent::~USpace3DUnrealComponent() {}
@@ -245,12 +513,46 @@ void USpace3DUnrealComponent::UpdateS3DProps()
   S3DUNREALCOMPONENTBUG;
 }
 
+bool USpace3DUnrealComponent::IsPosedExternally() const
+{
+  return bPosedByTrajectory;
+}
+
+TFunction<bool(uint64_t)> USpace3DUnrealComponent::MakeOnCreated()
+{
+  return MakeOnCreated([](USpace3DUnrealComponent* Component, uint64_t NewUuid) { Component->uuid = NewUuid; });
+}
+
+TFunction<bool(uint64_t)> USpace3DUnrealComponent::MakeOnCreated(TFunction<void(USpace3DUnrealComponent*, uint64_t)> Assign)
+{
+  TWeakObjectPtr<USpace3DUnrealComponent> Weak(this);
+  uint32 Ticket = AddTicket;
+  return [Weak, Ticket, Assign = MoveTemp(Assign)](uint64_t NewUuid)
+  {
+    USpace3DUnrealComponent* Component = Weak.Get();
+    if(Component == nullptr || Component->AddTicket != Ticket) return false;
+    Assign(Component, NewUuid);
+    return true;
+  };
+}
+
+bool USpace3DUnrealComponent::IsStaticAfterBeginPlay() const
+{
+  if(Motion == ESpace3DUnrealMotion::Auto)
+  {
+    const USceneComponent* Parent = GetAttachParent();
+    return Mobility == EComponentMobility::Static || (Parent != nullptr && Parent->Mobility == EComponentMobility::Static);
+  }
+  return Motion == ESpace3DUnrealMotion::StaticAfterBeginPlay;
+}
+
 void USpace3DUnrealComponent::OnRegister()
 {
   USceneComponent::OnRegister();
   if(GetWorld()->IsGameWorld())
   {
     CreateS3DObject();
+    GetWorld()->GetSubsystem<USpace3DUnrealSubsystem>()->Register(this);
   }
   else
   {
@@ -262,74 +564,19 @@ void USpace3DUnrealComponent::OnRegister()
 void USpace3DUnrealComponent::OnUnregister()
 {
   USceneComponent::OnUnregister();
+  USpace3DUnrealSubsystem* Subsystem = GetWorld() != nullptr ? GetWorld()->GetSubsystem<USpace3DUnrealSubsystem>() : nullptr;
+  if(Subsystem != nullptr) Subsystem->Unregister(this);
   if(!IntentionallyNotCreated)
   {
     DestroyS3DObject();
   }
+  if(bPosedByTrajectory) Space3DUnreal::GetTrajectories().UnbindObject(uuid);
+  bPosedByTrajectory = false;
   uuid = 0;
-  LastT = 0;
+  ++AddTicket;
   IntentionallyNotCreated = false;
 }
 
-void USpace3DUnrealComponent::TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction *ThisTickFunction)
-{
-  if(IntentionallyNotCreated) return;
-  PreTick();
-  if(IntentionallyNotCreated) return;
-  
-  if(uuid == 0 || !Space3D::DoesObjectExist(uuid))
-  {
-    S3DUNREALCOMPONENTBUG;
-    return;
-  }
-  
-  if(DeltaTime == 0.0f)
-  {
-    UE_LOG(LogSpace3DUnreal, Warning, TEXT("TickComponent DeltaTime = 0"));
-  }
-  else if(DeltaTime < 0.0f)
-  {
-    UE_LOG(LogSpace3DUnreal, Warning, TEXT("TickComponent DeltaTime < 0, = %f"), DeltaTime);
-  }
-  
-  uint64_t EstT = LastT + (uint64_t)((double)DeltaTime * 1000000000.0);
-  uint64_t NsPerFrame = (Space3D::FrameLength() * 1000000000ull) / (uint64_t)Space3D::GetParams()->fs;
-  uint64_t AudioT = Space3DUnreal::GetAudioT() + NsPerFrame;
-  //UE_LOG(LogSpace3DUnreal, Display, TEXT("Delta %f Est %d Audio %d ms"), DeltaTime * 1000.0f, (EstT / 1000000ull), (AudioT / 1000000ull));
-  
-  bool bResync = true;
-  uint64_t NsOffResync = NsPerFrame * 2 + NsPerFrame / 2; //2.5 frames off
-  if(EstT > AudioT && EstT - AudioT > NsOffResync)
-  {
-    UE_LOG(LogSpace3DUnreal, Display, TEXT("Component %d ms ahead of audio, re-synchronizing"), (EstT - AudioT) / 1000000ull);
-    LastT = AudioT;
-  }
-  else if(AudioT > EstT && AudioT - EstT > NsOffResync)
-  {
-    UE_LOG(LogSpace3DUnreal, Display, TEXT("Component %d ms behind audio, re-synchronizing"), (AudioT - EstT) / 1000000ull);
-    LastT = AudioT;
-  }
-  else
-  {
-    LastT = EstT;
-    bResync = false;
-  }
-  
-  glm::vec3 P = Space3DUnreal::GetScaleFactor() * U2GV(GetComponentLocation());
-  glm::quat R = U2GQ(GetComponentQuat());
-  glm::vec3 S = (RequiresScaleScale() ? Space3DUnreal::GetScaleFactor() : 1.0f) * U2GV(GetComponentScale());
-  if(bResync)
-  {
-    Space3D::PhysReset(uuid, LastT, P, R, S);
-  }
-  else
-  {
-    Space3D::PhysUpdate(uuid, LastT, P, R, S);
-  }
-  
-  UpdateS3DProps();
-}
-
 #undef LOCTEXT_NAMESPACE
 
 IMPLEMENT_MODULE(FSpace3DUnrealModule, Space3DUnreal)
@@ -1,26 +1,43 @@
 #include "Space3DUnrealBlueprint.h"
+#include "Space3DUnrealFrameQueue.h"
+#include "Space3DUnrealGovernor.h"
+#include "Space3DUnrealDryPath.h"
+#include "Space3DUnrealClock.h"
 #include "Space3D.hpp"
 
 void UpdateParams::UpdateOrder(int order)
 {
+    //The governor scales down from here, so it must not restore the old value
+    FSpace3DUnrealGovernor::FQuality Ceiling = Space3DUnreal::GetGovernor().GetCeiling();
+    Ceiling.Order = order;
+    Space3DUnreal::GetGovernor().SetCeiling(Ceiling);
     Space3D::SpatParams* p = Space3D::GetParams();
     p->order = order;
 }
 
 void UpdateParams::UpdateRTRays(int rt_rays)
 {
+    FSpace3DUnrealGovernor::FQuality Ceiling = Space3DUnreal::GetGovernor().GetCeiling();
+    Ceiling.RTRays = rt_rays;
+    Space3DUnreal::GetGovernor().SetCeiling(Ceiling);
     Space3D::SpatParams* p = Space3D::GetParams();
     p->rt_rays = rt_rays;
 }
 
 void UpdateParams::UpdateRTBranches(int rt_branches)
 {
+    FSpace3DUnrealGovernor::FQuality Ceiling = Space3DUnreal::GetGovernor().GetCeiling();
+    Ceiling.RTBranches = rt_branches;
+    Space3DUnreal::GetGovernor().SetCeiling(Ceiling);
     Space3D::SpatParams* p = Space3D::GetParams();
     p->rt_branches = rt_branches;
 }
 
 void UpdateParams::UpdateDiffNAngles(int n_angles) 
 {
+    FSpace3DUnrealGovernor::FQuality Ceiling = Space3DUnreal::GetGovernor().GetCeiling();
+    Ceiling.DiffNAngles = n_angles;
+    Space3DUnreal::GetGovernor().SetCeiling(Ceiling);
     Space3D::SpatParams* p = Space3D::GetParams();
     p->vdat_nangles = n_angles;
 }
@@ -58,3 +75,42 @@ FString UViewerBP::GetPerformance()
   
   return FString(MAX_PERFSTRINGSIZE, performance_string);
 }
+
+FSpace3DUnrealFrameStats UViewerBP::GetFrameStats()
+{
+  FSpace3DUnrealFrameQueue::FStats QueueStats = Space3DUnreal::GetFrameQueue().GetStats();
+  FSpace3DUnrealFrameStats Stats;
+  Stats.Rendered = (int32)QueueStats.Rendered;
+  Stats.Played = (int32)QueueStats.Played;
+  Stats.Dropped = (int32)QueueStats.Dropped;
+  Stats.Late = (int32)QueueStats.Late;
+  Stats.Duplicates = (int32)QueueStats.Duplicates;
+  Stats.QueueDepth = (int32)QueueStats.Depth;
+  Stats.Fallback = (int32)Space3DUnreal::GetDryPath().NumFallbackBuffers();
+  return Stats;
+}
+
+FSpace3DUnrealGovernorStats UViewerBP::GetGovernorStats()
+{
+  FSpace3DUnrealGovernor::FStats GovernorStats = Space3DUnreal::GetGovernor().GetStats();
+  FSpace3DUnrealGovernorStats Stats;
+  Stats.Tier = GovernorStats.Tier;
+  Stats.NumTiers = GovernorStats.NumTiers;
+  Stats.LoadPercent = GovernorStats.Load * 100.0f;
+  Stats.HeadroomPercent = 100.0f - Stats.LoadPercent;
+  Stats.DeadlineMs = GovernorStats.DeadlineMs;
+  Stats.Overruns = (int32)GovernorStats.Overruns;
+  Stats.TierChanges = (int32)GovernorStats.TierChanges;
+  return Stats;
+}
+
+FSpace3DUnrealClockStats UViewerBP::GetClockStats()
+{
+  FSpace3DUnrealClock::FStats ClockStats = Space3DUnreal::GetClock().GetStats();
+  FSpace3DUnrealClockStats Stats;
+  Stats.DriftPpm = ClockStats.DriftPpm;
+  Stats.JitterMs = ClockStats.JitterMs;
+  Stats.ErrorMs = ClockStats.ErrorMs;
+  Stats.Resyncs = (int32)ClockStats.Resyncs;
+  return Stats;
+}
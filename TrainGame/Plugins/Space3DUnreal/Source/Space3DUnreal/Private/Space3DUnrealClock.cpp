@@ -0,0 +1,128 @@
+#include "Space3DUnrealClock.h"
+#include "Space3DUnreal.h"
+#include "CoreGlobals.h"
+
+namespace
+{
+  /** Share of the phase error corrected each frame, and gain of the rate correction. */
+  constexpr double PhaseGain = 0.03;
+  constexpr double RateGain = 0.0002;
+  /** Audio and wall clocks never differ by more than this; anything more is noise. */
+  constexpr double MaxRateError = 0.01;
+  /** Error, in engine buffers, beyond which the estimate jumps instead of converging. */
+  constexpr double ResyncBuffers = 4.0;
+  /** Weight of each frame's error in the jitter statistic. */
+  constexpr double JitterSmoothing = 0.05;
+}
+
+FSpace3DUnrealClock::FSpace3DUnrealClock()
+  : Seq(0)
+  , ObservedT(0)
+  , ObservedAt(0.0)
+  , LastFrame(~0ull)
+  , LastTick(0.0)
+  , Phase(0.0)
+  , Rate(1.0)
+  , bLocked(false)
+  , bLastResync(false)
+  , LastT(0)
+  , Jitter(0.0)
+  , StatDriftPpm(0.0f)
+  , StatJitterMs(0.0f)
+  , StatErrorMs(0.0f)
+  , NumResyncs(0)
+{}
+
+void FSpace3DUnrealClock::OnAudioTime(uint64_t T)
+{
+  double Now = FPlatformTime::Seconds();
+  uint32 s = Seq.load(std::memory_order_relaxed);
+  Seq.store(s + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  ObservedT.store(T, std::memory_order_relaxed);
+  ObservedAt.store(Now, std::memory_order_relaxed);
+  Seq.store(s + 2, std::memory_order_release);
+}
+
+bool FSpace3DUnrealClock::ReadObservation(uint64_t& T, double& At) const
+{
+  for(int32 i=0; i<4; ++i)
+  {
+    uint32 s = Seq.load(std::memory_order_acquire);
+    if(s == 0) return false;
+    if(s & 1) continue;
+    T = ObservedT.load(std::memory_order_relaxed);
+    At = ObservedAt.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if(Seq.load(std::memory_order_relaxed) == s) return true;
+  }
+  return false;
+}
+
+uint64_t FSpace3DUnrealClock::Tick(bool& bOutResync)
+{
+  if(GFrameCounter == LastFrame)
+  {
+    bOutResync = bLastResync;
+    return LastT;
+  }
+  LastFrame = GFrameCounter;
+  double Now = FPlatformTime::Seconds();
+  double dtNs = LastTick > 0.0 ? (Now - LastTick) * 1000000000.0 : 0.0;
+  LastTick = Now;
+  bOutResync = false;
+
+  double Predicted = Phase + dtNs * Rate;
+  uint64_t ObsT;
+  double ObsAt;
+  if(!ReadObservation(ObsT, ObsAt))
+  {
+    //Audio hasn't started yet; free-run
+    Phase = Predicted;
+  }
+  else
+  {
+    double Lead = (double)Space3DUnreal::GetNsPerBuffer();
+    double Measured = (double)ObsT + (Now - ObsAt) * 1000000000.0 + Lead;
+    double Error = Measured - Predicted;
+    if(!bLocked || FMath::Abs(Error) > ResyncBuffers * Lead)
+    {
+      if(bLocked)
+      {
+        UE_LOG(LogSpace3DUnreal, Display, TEXT("Components %d ms %s audio, re-synchronizing"), (int32)(FMath::Abs(Error) / 1000000.0), Error < 0.0 ? TEXT("ahead of") : TEXT("behind"));
+        NumResyncs.fetch_add(1, std::memory_order_relaxed);
+      }
+      Phase = Measured;
+      Rate = 1.0;
+      Jitter = 0.0;
+      bLocked = true;
+      bOutResync = true;
+    }
+    else
+    {
+      Phase = Predicted + PhaseGain * Error;
+      if(dtNs > 0.0) Rate = FMath::Clamp(Rate + RateGain * Error / dtNs, 1.0 - MaxRateError, 1.0 + MaxRateError);
+      Jitter = FMath::Lerp(Jitter, FMath::Abs(Error), JitterSmoothing);
+    }
+    StatErrorMs.store((float)(Error / 1000000.0), std::memory_order_relaxed);
+  }
+
+  //PhysUpdate times must increase, unless everything which moved is being reset
+  uint64_t T = (uint64_t)FMath::Max(Phase, 0.0);
+  if(T <= LastT && !bOutResync) T = LastT + 1;
+  LastT = T;
+  bLastResync = bOutResync;
+  StatDriftPpm.store((float)((Rate - 1.0) * 1000000.0), std::memory_order_relaxed);
+  StatJitterMs.store((float)(Jitter / 1000000.0), std::memory_order_relaxed);
+  return T;
+}
+
+FSpace3DUnrealClock::FStats FSpace3DUnrealClock::GetStats() const
+{
+  FStats Stats;
+  Stats.DriftPpm = StatDriftPpm.load(std::memory_order_relaxed);
+  Stats.JitterMs = StatJitterMs.load(std::memory_order_relaxed);
+  Stats.ErrorMs = StatErrorMs.load(std::memory_order_relaxed);
+  Stats.Resyncs = NumResyncs.load(std::memory_order_relaxed);
+  return Stats;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include <atomic>
+
+/**
+Maps game frames onto the audio clock, for the as_of_time of component physics updates.
+
+The audio render thread reports each audio time it reaches (OnAudioTime). Those reports arrive in bursts, one per engine buffer, whenever the audio device gets around to it, so using the latest one directly makes component timestamps jitter by up to a buffer, and drift between the game and audio clocks eventually forces a hard re-synchronization. Instead, a second-order phase-locked loop tracks the audio clock against the wall clock: each game frame, the estimate is advanced at the estimated rate, then pulled a fraction of the way towards the latest report (phase), while the rate is nudged to cancel any steady error (drift). Only an error of several buffers--a hitch, or audio restarting--causes a hard re-synchronization.
+
+Estimates are one engine buffer ahead of the audio clock, so that updates are in Space3D before the audio which needs them is rendered.
+*/
+class FSpace3DUnrealClock
+{
+public:
+  struct FStats
+  {
+    /** Audio clock rate relative to the wall clock, in parts per million. */
+    float DriftPpm;
+    /** Smoothed size of the error between the estimate and the audio reports. */
+    float JitterMs;
+    /** Error at the last update. */
+    float ErrorMs;
+    uint32 Resyncs;
+  };
+
+  FSpace3DUnrealClock();
+
+  /** Audio render thread: the audio clock has just reached T. */
+  void OnAudioTime(uint64_t T);
+
+  /** Game thread: audio time for this game frame. Updates the estimate the first time it is called each frame; bOutResync is set if it jumped instead of being smoothed. */
+  uint64_t Tick(bool& bOutResync);
+
+  /** Any thread. */
+  FStats GetStats() const;
+
+private:
+  bool ReadObservation(uint64_t& T, double& At) const;
+
+  //Latest report from the audio thread, with the wall clock time it was made
+  std::atomic<uint32> Seq;
+  std::atomic<uint64_t> ObservedT;
+  std::atomic<double> ObservedAt;
+
+  //Game thread state
+  uint64 LastFrame;
+  double LastTick;
+  /** Estimated audio time at LastTick in ns, and audio ns per wall ns. */
+  double Phase, Rate;
+  bool bLocked, bLastResync;
+  uint64_t LastT;
+  double Jitter;
+
+  std::atomic<float> StatDriftPpm, StatJitterMs, StatErrorMs;
+  std::atomic<uint32> NumResyncs;
+};
@@ -0,0 +1,172 @@
+#include "Space3DUnrealCommandBuffer.h"
+#include "Space3DUnreal.h"
+
+#include "Space3D.hpp"
+
+namespace
+{
+  /** More spare vertex buffers than this are freed; enough for every skinned mesh in a busy scene. */
+  constexpr int32 MaxPooledVertexBuffers = 64;
+}
+
+bool FSpace3DUnrealCommandBuffer::FFrame::IsEmpty() const
+{
+  return Adds.Num() == 0 && Removes.Num() == 0 && Props.Num() == 0 && Transforms.Num() == 0 && Vertices.Num() == 0;
+}
+
+void FSpace3DUnrealCommandBuffer::FFrame::Reset()
+{
+  Adds.Reset();
+  Removes.Reset();
+  Props.Reset();
+  Transforms.Reset();
+  Vertices.Reset();
+}
+
+void FSpace3DUnrealCommandBuffer::Add(EObject Type, TFunction<uint64_t()> Create, TFunction<bool(uint64_t)> OnCreated)
+{
+  FScopeLock Lock(&RecordLock);
+  Recording.Adds.Add(FAdd{Type, MoveTemp(Create), MoveTemp(OnCreated)});
+}
+
+void FSpace3DUnrealCommandBuffer::Remove(EObject Type, uint64_t uuid)
+{
+  FScopeLock Lock(&RecordLock);
+  Recording.Removes.Add(FRemove{Type, uuid});
+}
+
+void FSpace3DUnrealCommandBuffer::SetProp(uint64_t uuid, EProp Prop, int32 Value)
+{
+  FScopeLock Lock(&RecordLock);
+  Recording.Props.Add(FPropKey{uuid, Prop}, Value);
+}
+
+void FSpace3DUnrealCommandBuffer::SetTransform(uint64_t uuid, uint64_t T, const FVector& Position, const FQuat& Rotation, const FVector& Scale, bool bReset)
+{
+  FScopeLock Lock(&RecordLock);
+  FTransformCmd& Cmd = Recording.Transforms.AddUninitialized_GetRef();
+  Cmd.uuid = uuid;
+  Cmd.T = T;
+  Cmd.Position = Position;
+  Cmd.Rotation = Rotation;
+  Cmd.Scale = Scale;
+  Cmd.bReset = bReset;
+}
+
+void FSpace3DUnrealCommandBuffer::SetMeshVertices(uint64_t uuid, TArray<FVector>&& Vertices, TArray<FVector>&& Normals)
+{
+  FScopeLock Lock(&RecordLock);
+  FVertices& V = Recording.Vertices.FindOrAdd(uuid);
+  RecycleVertexBuffer(MoveTemp(V.Vertices));
+  V.Vertices = MoveTemp(Vertices);
+  V.Normals = MoveTemp(Normals);
+}
+
+TArray<FVector> FSpace3DUnrealCommandBuffer::AcquireVertexBuffer()
+{
+  FScopeLock Lock(&RecordLock);
+  return VertexPool.Num() > 0 ? VertexPool.Pop(false) : TArray<FVector>();
+}
+
+void FSpace3DUnrealCommandBuffer::RecycleVertexBuffer(TArray<FVector>&& Buffer)
+{
+  if(Buffer.Max() == 0 || VertexPool.Num() >= MaxPooledVertexBuffers) return;
+  Buffer.Reset();
+  VertexPool.Add(MoveTemp(Buffer));
+}
+
+void FSpace3DUnrealCommandBuffer::RemoveObject(EObject Type, uint64_t uuid)
+{
+  switch(Type)
+  {
+  case EObject::Head: Space3D::HeadRemove(uuid); break;
+  case EObject::Mic: Space3D::MicRemove(uuid); break;
+  case EObject::Speaker: Space3D::SpeakerRemove(uuid); break;
+  case EObject::Mesh: Space3D::MeshRemove(uuid); break;
+  }
+}
+
+void FSpace3DUnrealCommandBuffer::Commit()
+{
+  FScopeLock CLock(&CommitLock);
+  {
+    FScopeLock Lock(&RecordLock);
+    if(Recording.IsEmpty()) return;
+    Swap(Recording, Committing);
+  }
+
+  TSet<uint64_t> Removed;
+  for(const FRemove& R : Committing.Removes)
+  {
+    Removed.Add(R.uuid);
+  }
+
+  {
+    SPACE3D_RAII_LOCK_API;
+    for(FAdd& A : Committing.Adds)
+    {
+      uint64_t uuid = A.Create();
+      if(uuid == 0)
+      {
+        UE_LOG(LogSpace3DUnreal, Error, TEXT("Space3D failed to create object"));
+        continue;
+      }
+      if(!A.OnCreated(uuid)) RemoveObject(A.Type, uuid);
+    }
+    for(const TPair<FPropKey, int32>& P : Committing.Props)
+    {
+      if(Removed.Contains(P.Key.uuid)) continue;
+      int32* Last = Committed.Find(P.Key);
+      if(Last != nullptr && *Last == P.Value) continue;
+      Committed.Add(P.Key, P.Value);
+      uint64_t uuid = P.Key.uuid;
+      switch(P.Key.Prop)
+      {
+      case EProp::HeadHRTF: Space3D::HeadSetHRTF(uuid, (uint8_t)P.Value); break;
+      case EProp::HeadChannel: Space3D::HeadSetChannel(uuid, (uint32_t)P.Value); break;
+      case EProp::HeadTestSound: Space3D::HeadTestSound(uuid, P.Value != 0); break;
+      case EProp::MicChannel: Space3D::MicSetChannel(uuid, (uint32_t)P.Value); break;
+      case EProp::MicTestSound: Space3D::MicTestSound(uuid, P.Value != 0); break;
+      case EProp::SpeakerChannel: Space3D::SpeakerSetChannel(uuid, (uint32_t)P.Value); break;
+      case EProp::SpeakerTestSound: Space3D::SpeakerTestSound(uuid, P.Value != 0); break;
+      case EProp::MeshMaterial: Space3D::MeshSetMaterial(uuid, (uint8_t)P.Value); break;
+      }
+    }
+    for(const TPair<uint64_t, FVertices>& V : Committing.Vertices)
+    {
+      if(Removed.Contains(V.Key)) continue;
+      const glm::vec3* Normals = V.Value.Normals.Num() > 0 ? (const glm::vec3*)V.Value.Normals.GetData() : nullptr;
+      Space3D::MeshSetVertices(V.Key, (const glm::vec3*)V.Value.Vertices.GetData(), Normals, false);
+    }
+    for(const FTransformCmd& Cmd : Committing.Transforms)
+    {
+      if(Removed.Contains(Cmd.uuid)) continue;
+      if(Cmd.bReset)
+      {
+        Space3D::PhysReset(Cmd.uuid, Cmd.T, U2GV(Cmd.Position), U2GQ(Cmd.Rotation), U2GV(Cmd.Scale));
+      }
+      else
+      {
+        Space3D::PhysUpdate(Cmd.uuid, Cmd.T, U2GV(Cmd.Position), U2GQ(Cmd.Rotation), U2GV(Cmd.Scale));
+      }
+    }
+    for(const FRemove& R : Committing.Removes)
+    {
+      RemoveObject(R.Type, R.uuid);
+    }
+  }
+
+  if(Removed.Num() > 0)
+  {
+    for(auto It = Committed.CreateIterator(); It; ++It)
+    {
+      if(Removed.Contains(It.Key().uuid)) It.RemoveCurrent();
+    }
+  }
+  if(Committing.Vertices.Num() > 0)
+  {
+    FScopeLock Lock(&RecordLock);
+    for(TPair<uint64_t, FVertices>& V : Committing.Vertices) RecycleVertexBuffer(MoveTemp(V.Value.Vertices));
+  }
+  Committing.Reset();
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+
+/**
+Changes to the Space3D scene, recorded from any thread and committed together under one API lock.
+
+Components record object creation and removal, property sets, transforms and mesh vertex uploads here instead of calling Space3D directly. USpace3DUnrealSubsystem commits everything once per game frame, after its own transform updates are recorded, so the audio thread never sees half of a frame's changes, and the API lock is taken once instead of once per component.
+
+Redundant writes are dropped: a property set to the value it already has in Space3D is not sent again, only the last of several property sets or vertex uploads for an object within a frame is sent, and nothing recorded for an object is sent once its removal has been recorded.
+
+Objects are created at commit time, because Space3D allocates their uuids; until then the recording component has no uuid and cannot record anything else for its object.
+*/
+class FSpace3DUnrealCommandBuffer
+{
+public:
+  enum class EObject : uint8 { Head, Mic, Speaker, Mesh };
+
+  enum class EProp : uint8
+  {
+    HeadHRTF, HeadChannel, HeadTestSound,
+    MicChannel, MicTestSound,
+    SpeakerChannel, SpeakerTestSound,
+    MeshMaterial
+  };
+
+  /** Create runs at commit, under the API lock, and returns the new object's uuid. OnCreated then gets the uuid, on the committing thread, and returns false if the object is no longer wanted, in which case it is removed again straight away. */
+  void Add(EObject Type, TFunction<uint64_t()> Create, TFunction<bool(uint64_t)> OnCreated);
+  void Remove(EObject Type, uint64_t uuid);
+  void SetProp(uint64_t uuid, EProp Prop, int32 Value);
+  /** Position and scale in Space3D units. Reset = PhysReset (teleport), otherwise PhysUpdate. */
+  void SetTransform(uint64_t uuid, uint64_t T, const FVector& Position, const FQuat& Rotation, const FVector& Scale, bool bReset);
+  /** Normals may be empty. */
+  void SetMeshVertices(uint64_t uuid, TArray<FVector>&& Vertices, TArray<FVector>&& Normals);
+  /** An empty array to fill and pass to SetMeshVertices, with the storage of an upload which has already been committed if there is one, so that meshes re-uploaded every frame do not allocate. */
+  TArray<FVector> AcquireVertexBuffer();
+
+  /** Sends everything recorded so far to Space3D, under the API lock. Called once per game frame by USpace3DUnrealSubsystem. */
+  void Commit();
+
+private:
+  struct FAdd
+  {
+    EObject Type;
+    TFunction<uint64_t()> Create;
+    TFunction<bool(uint64_t)> OnCreated;
+  };
+
+  struct FRemove
+  {
+    EObject Type;
+    uint64_t uuid;
+  };
+
+  struct FPropKey
+  {
+    uint64_t uuid;
+    EProp Prop;
+    bool operator==(const FPropKey& Other) const { return uuid == Other.uuid && Prop == Other.Prop; }
+    friend uint32 GetTypeHash(const FPropKey& Key) { return HashCombine(GetTypeHash(Key.uuid), (uint32)Key.Prop); }
+  };
+
+  struct FTransformCmd
+  {
+    uint64_t uuid, T;
+    FVector Position, Scale;
+    FQuat Rotation;
+    bool bReset;
+  };
+
+  struct FVertices
+  {
+    TArray<FVector> Vertices, Normals;
+  };
+
+  /** One frame's worth of commands. */
+  struct FFrame
+  {
+    TArray<FAdd> Adds;
+    TArray<FRemove> Removes;
+    TMap<FPropKey, int32> Props;
+    TArray<FTransformCmd> Transforms;
+    TMap<uint64_t, FVertices> Vertices;
+
+    bool IsEmpty() const;
+    void Reset();
+  };
+
+  static void RemoveObject(EObject Type, uint64_t uuid);
+  /** Under RecordLock. */
+  void RecycleVertexBuffer(TArray<FVector>&& Buffer);
+
+  FCriticalSection RecordLock;
+  /** Being recorded, under RecordLock, and being committed. Swapped at commit so recording never waits for Space3D. */
+  FFrame Recording, Committing;
+  /** Under RecordLock: storage of committed vertex uploads, for AcquireVertexBuffer. */
+  TArray<TArray<FVector>> VertexPool;
+  /** Only touched by Commit(): property values as last sent to Space3D. */
+  TMap<FPropKey, int32> Committed;
+  FCriticalSection CommitLock;
+};
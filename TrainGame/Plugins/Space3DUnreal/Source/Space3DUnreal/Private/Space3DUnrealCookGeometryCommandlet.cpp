@@ -0,0 +1,90 @@
+#include "Space3DUnrealCookGeometryCommandlet.h"
+#include "Space3DUnreal.h"
+#include "Space3DUnrealMeshes.h"
+#include "Space3DUnrealMeshLoader.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/Level.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "UObject/Package.h"
+#include "UObject/UObjectGlobals.h"
+
+#if WITH_EDITOR
+#include "AssetRegistryModule.h"
+#endif
+
+USpace3DUnrealCookGeometryCommandlet::USpace3DUnrealCookGeometryCommandlet()
+{
+  IsClient = false;
+  IsServer = false;
+  IsEditor = true;
+  LogToConsole = true;
+}
+
+int32 USpace3DUnrealCookGeometryCommandlet::Main(const FString& Params)
+{
+#if WITH_EDITOR
+  //Maps to go through: those asked for, or all of the project's
+  TArray<FString> Maps;
+  FString MapsParam;
+  if(FParse::Value(*Params, TEXT("Maps="), MapsParam, false))
+  {
+    MapsParam.ParseIntoArray(Maps, TEXT("+"), true);
+  }
+  else
+  {
+    IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>(TEXT("AssetRegistry")).Get();
+    AssetRegistry.SearchAllAssets(true);
+    TArray<FAssetData> Assets;
+    AssetRegistry.GetAssetsByClass(UWorld::StaticClass()->GetFName(), Assets, true);
+    for(const FAssetData& Asset : Assets)
+    {
+      if(Asset.PackageName.ToString().StartsWith(TEXT("/Game/"))) Maps.Add(Asset.PackageName.ToString());
+    }
+  }
+
+  int32 NumCooked = 0, NumFailed = 0;
+  for(const FString& Map : Maps)
+  {
+    UPackage* Package = LoadPackage(nullptr, *Map, LOAD_None);
+    UWorld* World = Package != nullptr ? UWorld::FindWorldInPackage(Package) : nullptr;
+    if(World == nullptr || World->PersistentLevel == nullptr)
+    {
+      UE_LOG(LogSpace3DUnreal, Error, TEXT("Could not load map %s"), *Map);
+      ++NumFailed;
+      continue;
+    }
+    UE_LOG(LogSpace3DUnreal, Display, TEXT("Cooking acoustic geometry for %s"), *Map);
+    //Streamed sublevels are maps of their own, gone through in turn
+    for(AActor* Actor : World->PersistentLevel->Actors)
+    {
+      if(Actor == nullptr) continue;
+      TInlineComponentArray<USpace3DUnrealMesh*> Components(Actor);
+      for(USpace3DUnrealMesh* Component : Components)
+      {
+        //As USpace3DUnrealMesh::CreateS3DObject finds it
+        UStaticMeshComponent* StaticMeshC = Cast<UStaticMeshComponent>(Component->GetAttachParent());
+        UStaticMesh* StaticMesh = StaticMeshC != nullptr ? StaticMeshC->GetStaticMesh() : nullptr;
+        if(StaticMesh == nullptr || !StaticMesh->ContainsPhysicsTriMeshData(true)) continue;
+        if(FSpace3DUnrealMeshLoader::Cook(*Component, *StaticMesh))
+        {
+          ++NumCooked;
+        }
+        else
+        {
+          UE_LOG(LogSpace3DUnreal, Error, TEXT("%s: Could not cook acoustic geometry of %s"), *Actor->GetName(), *StaticMesh->GetPathName());
+          ++NumFailed;
+        }
+      }
+    }
+    //One map at a time in memory
+    CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+  }
+  UE_LOG(LogSpace3DUnreal, Display, TEXT("Cooked acoustic geometry for %d meshes in %d maps, %d failed"), NumCooked, Maps.Num(), NumFailed);
+  return NumFailed > 0 ? 1 : 0;
+#else
+  UE_LOG(LogSpace3DUnreal, Error, TEXT("Acoustic geometry can only be cooked in the editor"));
+  return 1;
+#endif
+}
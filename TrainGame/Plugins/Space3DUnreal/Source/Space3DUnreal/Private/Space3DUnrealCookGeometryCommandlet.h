@@ -0,0 +1,24 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+
+#include "Space3DUnrealCookGeometryCommandlet.generated.h"
+
+/**
+Writes the cooked acoustic geometry (see FSpace3DUnrealGeometryCache) of every static mesh a USpace3DUnrealMesh is attached to in the project's maps, so that packaged builds load it from Content/Space3D/Geometry instead of extracting and simplifying it at runtime. Meshes which already have a cooked file for their current collision and proxy settings are skipped.
+
+Run it before packaging, whenever meshes or their Space3D settings have changed:
+  UE4Editor-Cmd <Project>.uproject -run=Space3DUnrealCookGeometry [-Maps=/Game/Maps/A+/Game/Maps/B]
+Without -Maps, every map in the project's content is cooked. Returns non-zero if any mesh could not be cooked.
+*/
+UCLASS()
+class USpace3DUnrealCookGeometryCommandlet : public UCommandlet
+{
+  GENERATED_BODY()
+
+public:
+  USpace3DUnrealCookGeometryCommandlet();
+
+  virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,246 @@
+#include "Space3DUnrealDSP.h"
+
+#include "Math/VectorRegister.h"
+
+namespace Space3DUnreal {
+  
+  static void DownmixScalar(const float* In, float* Out, int32 Start, int32 NumFrames, int32 NumChannels, float Gain)
+  {
+    for(int32 i=Start; i<NumFrames; ++i)
+    {
+      const float* Frame = In + i * NumChannels;
+      float Sum = 0.0f;
+      for(int32 c=0; c<NumChannels; ++c) Sum += Frame[c];
+      Out[i] = Sum * Gain;
+    }
+  }
+  
+  //Given four frames of four channels each, returns the per-frame channel sums.
+  static FORCEINLINE VectorRegister SumQuads(VectorRegister A, VectorRegister B, VectorRegister C, VectorRegister D)
+  {
+    VectorRegister AB = VectorAdd(VectorShuffle(A, B, 0, 1, 0, 1), VectorShuffle(A, B, 2, 3, 2, 3)); //a0+a2 a1+a3 b0+b2 b1+b3
+    VectorRegister CD = VectorAdd(VectorShuffle(C, D, 0, 1, 0, 1), VectorShuffle(C, D, 2, 3, 2, 3));
+    return VectorAdd(VectorShuffle(AB, CD, 0, 2, 0, 2), VectorShuffle(AB, CD, 1, 3, 1, 3));
+  }
+  
+  float MeanSquare(const float* In, int32 NumFrames)
+  {
+    if(NumFrames <= 0) return 0.0f;
+    VectorRegister Acc0 = VectorZero();
+    VectorRegister Acc1 = VectorZero();
+    int32 i = 0;
+    for(; i+8<=NumFrames; i+=8)
+    {
+      VectorRegister A = VectorLoad(In + i);
+      VectorRegister B = VectorLoad(In + i + 4);
+      Acc0 = VectorMultiplyAdd(A, A, Acc0);
+      Acc1 = VectorMultiplyAdd(B, B, Acc1);
+    }
+    float Sums[4];
+    VectorStore(VectorAdd(Acc0, Acc1), Sums);
+    float Sum = Sums[0] + Sums[1] + Sums[2] + Sums[3];
+    for(; i<NumFrames; ++i) Sum += In[i] * In[i];
+    return Sum / (float)NumFrames;
+  }
+  
+  void DownmixToMono(const float* In, float* Out, int32 NumFrames, int32 NumChannels, float Gain)
+  {
+    check(NumChannels >= 1);
+    if(NumChannels == 1 && Gain == 1.0f)
+    {
+      FMemory::Memcpy(Out, In, NumFrames * sizeof(float));
+      return;
+    }
+    const VectorRegister G = VectorSetFloat1(Gain);
+    int32 i = 0;
+    switch(NumChannels)
+    {
+    case 1:
+      for(; i+4<=NumFrames; i+=4)
+      {
+        VectorStore(VectorMultiply(VectorLoad(In + i), G), Out + i);
+      }
+      break;
+    case 2:
+      for(; i+4<=NumFrames; i+=4)
+      {
+        VectorRegister A = VectorLoad(In + 2*i);     //L0 R0 L1 R1
+        VectorRegister B = VectorLoad(In + 2*i + 4); //L2 R2 L3 R3
+        VectorRegister L = VectorShuffle(A, B, 0, 2, 0, 2);
+        VectorRegister R = VectorShuffle(A, B, 1, 3, 1, 3);
+        VectorStore(VectorMultiply(VectorAdd(L, R), G), Out + i);
+      }
+      break;
+    case 4:
+      for(; i+4<=NumFrames; i+=4)
+      {
+        const float* F = In + 4*i;
+        VectorRegister S = SumQuads(VectorLoad(F), VectorLoad(F + 4), VectorLoad(F + 8), VectorLoad(F + 12));
+        VectorStore(VectorMultiply(S, G), Out + i);
+      }
+      break;
+    case 8:
+      for(; i+4<=NumFrames; i+=4)
+      {
+        const float* F = In + 8*i;
+        VectorRegister A = VectorAdd(VectorLoad(F     ), VectorLoad(F +  4));
+        VectorRegister B = VectorAdd(VectorLoad(F +  8), VectorLoad(F + 12));
+        VectorRegister C = VectorAdd(VectorLoad(F + 16), VectorLoad(F + 20));
+        VectorRegister D = VectorAdd(VectorLoad(F + 24), VectorLoad(F + 28));
+        VectorStore(VectorMultiply(SumQuads(A, B, C, D), G), Out + i);
+      }
+      break;
+    default:
+      break;
+    }
+    DownmixScalar(In, Out, i, NumFrames, NumChannels, Gain);
+  }
+  
+  
+  //4x4 transpose: rows are four channels of four consecutive frames, results are four frames of four consecutive channels.
+  static FORCEINLINE void Transpose4(VectorRegister& R0, VectorRegister& R1, VectorRegister& R2, VectorRegister& R3)
+  {
+    VectorRegister T0 = VectorShuffle(R0, R1, 0, 1, 0, 1); //a0 a1 b0 b1
+    VectorRegister T1 = VectorShuffle(R0, R1, 2, 3, 2, 3); //a2 a3 b2 b3
+    VectorRegister T2 = VectorShuffle(R2, R3, 0, 1, 0, 1); //c0 c1 d0 d1
+    VectorRegister T3 = VectorShuffle(R2, R3, 2, 3, 2, 3); //c2 c3 d2 d3
+    R0 = VectorShuffle(T0, T2, 0, 2, 0, 2);
+    R1 = VectorShuffle(T0, T2, 1, 3, 1, 3);
+    R2 = VectorShuffle(T1, T3, 0, 2, 0, 2);
+    R3 = VectorShuffle(T1, T3, 1, 3, 1, 3);
+  }
+  
+  //Interleaves channels [C0, C0+4) of frames [S, S+4) into Out, which has NumChannels channels.
+  static FORCEINLINE void InterleaveQuad(const float* Planar, int32 PlanarStride, float* Out, int32 NumChannels, int32 C0, int32 S)
+  {
+    const float* P = Planar + C0 * PlanarStride + S;
+    VectorRegister R0 = VectorLoad(P);
+    VectorRegister R1 = VectorLoad(P + PlanarStride);
+    VectorRegister R2 = VectorLoad(P + 2 * PlanarStride);
+    VectorRegister R3 = VectorLoad(P + 3 * PlanarStride);
+    Transpose4(R0, R1, R2, R3);
+    float* O = Out + S * NumChannels + C0;
+    VectorStore(R0, O);
+    VectorStore(R1, O + NumChannels);
+    VectorStore(R2, O + 2 * NumChannels);
+    VectorStore(R3, O + 3 * NumChannels);
+  }
+  
+  //Interleaves channels [CStart, CEnd) of frames [SStart, SEnd) into Out, which has NumChannels channels.
+  static void InterleaveScalar(const float* Planar, int32 PlanarStride, float* Out, int32 NumChannels, int32 CStart, int32 CEnd, int32 SStart, int32 SEnd)
+  {
+    for(int32 c=CStart; c<CEnd; ++c)
+    {
+      const float* In = Planar + c * PlanarStride;
+      for(int32 s=SStart; s<SEnd; ++s)
+      {
+        Out[s*NumChannels+c] = In[s];
+      }
+    }
+  }
+  
+  template<int32 NumChannels> static void InterleaveFixed(const float* Planar, int32 PlanarStride, float* Out, int32 NumFrames)
+  {
+    static_assert(NumChannels % 4 == 0, "Use the stereo kernel or the generic path");
+    int32 s = 0;
+    for(; s+4<=NumFrames; s+=4)
+    {
+      for(int32 c=0; c<NumChannels; c+=4)
+      {
+        InterleaveQuad(Planar, PlanarStride, Out, NumChannels, c, s);
+      }
+    }
+    InterleaveScalar(Planar, PlanarStride, Out, NumChannels, 0, NumChannels, s, NumFrames);
+  }
+  
+  template<> void InterleaveFixed<2>(const float* Planar, int32 PlanarStride, float* Out, int32 NumFrames)
+  {
+    const float* L = Planar;
+    const float* R = Planar + PlanarStride;
+    int32 s = 0;
+    for(; s+4<=NumFrames; s+=4)
+    {
+      VectorRegister VL = VectorLoad(L + s);
+      VectorRegister VR = VectorLoad(R + s);
+      VectorRegister Lo = VectorShuffle(VL, VR, 0, 1, 0, 1); //L0 L1 R0 R1
+      VectorRegister Hi = VectorShuffle(VL, VR, 2, 3, 2, 3); //L2 L3 R2 R3
+      VectorStore(VectorShuffle(Lo, Lo, 0, 2, 1, 3), Out + 2*s);
+      VectorStore(VectorShuffle(Hi, Hi, 0, 2, 1, 3), Out + 2*s + 4);
+    }
+    InterleaveScalar(Planar, PlanarStride, Out, 2, 0, 2, s, NumFrames);
+  }
+  
+  void Interleave(const float* Planar, int32 PlanarStride, float* Out, int32 NumFrames, int32 NumChannels)
+  {
+    switch(NumChannels)
+    {
+    case 2: InterleaveFixed<2>(Planar, PlanarStride, Out, NumFrames); return;
+    case 8: InterleaveFixed<8>(Planar, PlanarStride, Out, NumFrames); return;
+    case 16: InterleaveFixed<16>(Planar, PlanarStride, Out, NumFrames); return;
+    case 24: InterleaveFixed<24>(Planar, PlanarStride, Out, NumFrames); return;
+    case 32: InterleaveFixed<32>(Planar, PlanarStride, Out, NumFrames); return;
+    default: break;
+    }
+    int32 Quads = NumChannels & ~3;
+    int32 s = 0;
+    for(; s+4<=NumFrames; s+=4)
+    {
+      for(int32 c=0; c<Quads; c+=4)
+      {
+        InterleaveQuad(Planar, PlanarStride, Out, NumChannels, c, s);
+      }
+    }
+    InterleaveScalar(Planar, PlanarStride, Out, NumChannels, 0, Quads, s, NumFrames);
+    InterleaveScalar(Planar, PlanarStride, Out, NumChannels, Quads, NumChannels, 0, NumFrames);
+  }
+  
+  
+  //Dot product of NumTaps (a multiple of 4) samples, left as four partial sums
+  static FORCEINLINE VectorRegister DotPartial(const float* X, const float* C, int32 NumTaps)
+  {
+    VectorRegister Acc = VectorZero();
+    for(int32 j=0; j<NumTaps; j+=4)
+    {
+      Acc = VectorMultiplyAdd(VectorLoad(X + j), VectorLoad(C + j), Acc);
+    }
+    return Acc;
+  }
+  
+  void PolyphaseFilter(const float* In, const float* Coeffs, int32 NumTaps, int32 Up, int32 Down, int32 Phase, float* Out, int32 NumOut)
+  {
+    check(NumTaps % 4 == 0);
+    int32 i = Phase / Up;
+    int32 p = Phase % Up;
+    VectorRegister Acc[4];
+    int32 n = 0;
+    while(n < NumOut)
+    {
+      int32 Block = FMath::Min(4, NumOut - n);
+      for(int32 k=0; k<4; ++k)
+      {
+        if(k >= Block)
+        {
+          Acc[k] = VectorZero();
+          continue;
+        }
+        Acc[k] = DotPartial(In + i, Coeffs + p * NumTaps, NumTaps);
+        p += Down;
+        i += p / Up;
+        p %= Up;
+      }
+      VectorRegister Sums = SumQuads(Acc[0], Acc[1], Acc[2], Acc[3]);
+      if(Block == 4)
+      {
+        VectorStore(Sums, Out + n);
+      }
+      else
+      {
+        float Tail[4];
+        VectorStore(Sums, Tail);
+        for(int32 k=0; k<Block; ++k) Out[n + k] = Tail[k];
+      }
+      n += Block;
+    }
+  }
+  
+}
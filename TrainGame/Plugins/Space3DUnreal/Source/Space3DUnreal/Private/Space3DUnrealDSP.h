@@ -0,0 +1,20 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** Audio-thread DSP kernels used by the plugin. These are written with UE's VectorRegister abstraction, so they compile to SSE on x64 and NEON on ARM. None of them allocate. */
+namespace Space3DUnreal {
+  
+  /** Mean of the squared samples of NumFrames of mono audio. */
+  float MeanSquare(const float* In, int32 NumFrames);
+  
+  /** Mixes NumFrames of interleaved NumChannels audio down to mono, scaling by Gain. In and Out must not overlap. Stereo, 4- and 8-channel input have dedicated vector kernels; other channel counts use a scalar loop. */
+  void DownmixToMono(const float* In, float* Out, int32 NumFrames, int32 NumChannels, float Gain);
+  
+  /** Interleaves NumFrames of NumChannels planar audio into Out. Channel c starts at Planar + c * PlanarStride. 2, 8, 16, 24 and 32 channels have kernels specialized at compile time; other counts transpose four channels at a time and finish with a scalar loop. */
+  void Interleave(const float* Planar, int32 PlanarStride, float* Out, int32 NumFrames, int32 NumChannels);
+  
+  /** Polyphase FIR resampling by Up / Down (see FSpace3DUnrealResampler). Output n is at input position t = Phase + n * Down in units of 1 / Up input samples; it is the dot product of In + t / Up with the NumTaps (a multiple of 4) coefficients of phase t % Up. Coeffs holds Up phases of NumTaps coefficients each. */
+  void PolyphaseFilter(const float* In, const float* Coeffs, int32 NumTaps, int32 Up, int32 Down, int32 Phase, float* Out, int32 NumOut);
+  
+}
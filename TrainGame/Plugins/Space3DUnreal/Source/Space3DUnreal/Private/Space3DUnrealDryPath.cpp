@@ -0,0 +1,322 @@
+#include "Space3DUnrealDryPath.h"
+#include "Space3DUnreal.h"
+
+#include "Space3D.hpp"
+
+namespace
+{
+  constexpr float SpeedOfSound = 343.0f;
+  constexpr float MaxDelaySeconds = 0.25f;
+  /** Space3D buffers which must arrive complete and on time before fading back to it. */
+  constexpr int32 RecoverBuffers = 2;
+  /** Without HRTFs, fully hard-panning sources to one ear sounds unnatural. */
+  constexpr float HeadPanWidth = 0.7f;
+  constexpr int32 MaxSinks = 64;
+  /** Set in LatestSinks while the latest sinks have not been taken by the audio render thread yet. */
+  constexpr int32 NewSinks = 4;
+
+  FVector G2UV(const glm::vec3& v) { return FVector(v.x, v.y, v.z); }
+}
+
+FSpace3DUnrealDryPath::FSpace3DUnrealDryPath()
+  : WritePos(0)
+  , bEnabled(false)
+  , DeadlineFrames(1.5f)
+  , CrossfadeMs(50.0f)
+  , FadeStep(1.0f)
+  , WetMix(1.0f)
+  , GoodBuffers(0)
+  , FallbackBuffers(0)
+{
+  Configure(0, 1, 48000.0f, 0);
+}
+
+void FSpace3DUnrealDryPath::Configure(int32 NumSlots, int32 BufferLength, float SampleRate, int32 NumChannels)
+{
+  BufLength = BufferLength;
+  Channels = NumChannels;
+  Rate = SampleRate;
+  MaxDelay = MaxDelaySeconds * Rate;
+  int32 HistoryLength = FMath::RoundUpToPowerOfTwo((uint32)(FMath::CeilToInt(MaxDelay) + BufLength + 2));
+  HistoryMask = HistoryLength - 1;
+  Sources.Empty();
+  Sources.AddDefaulted(NumSlots);
+  for(FSource& Source : Sources)
+  {
+    Source.History.SetNumZeroed(HistoryLength);
+    Source.Gains.SetNumZeroed(Channels);
+    Source.Position = FVector::ZeroVector;
+    Source.Volume = 0.0f;
+    Source.Delay = 0.0f;
+    Source.bActive = Source.bRendered = false;
+  }
+  for(FSinkSet& Set : SinkSets)
+  {
+    Set.Sinks.Empty(MaxSinks);
+    Set.ListenerPosition = FVector::ZeroVector;
+  }
+  WriteSinks = 0;
+  ReadSinks = 1;
+  LatestSinks.store(2);
+  Scratch.SetNumZeroed(Channels * BufLength);
+  Delayed.SetNumZeroed(BufLength);
+  TargetGains.SetNumZeroed(Channels);
+  WritePos = 0;
+  WetMix = 1.0f;
+  GoodBuffers = 0;
+  UpdateFadeStep();
+}
+
+void FSpace3DUnrealDryPath::SetConfig(bool bInEnabled, float InDeadlineFrames, float InCrossfadeMs)
+{
+  bEnabled = bInEnabled;
+  DeadlineFrames = InDeadlineFrames;
+  CrossfadeMs = InCrossfadeMs;
+  UpdateFadeStep();
+}
+
+void FSpace3DUnrealDryPath::UpdateFadeStep()
+{
+  float FadeSamples = FMath::Max(CrossfadeMs * 0.001f * Rate, 1.0f);
+  FadeStep = FMath::Min((float)BufLength / FadeSamples, 1.0f);
+}
+
+void FSpace3DUnrealDryPath::SetSource(int32 Slot, const float* Audio, const FVector& Position, float Volume)
+{
+  FSource& Source = Sources[Slot];
+  Source.bActive = bEnabled && Audio != nullptr;
+  if(!Source.bActive)
+  {
+    Source.bRendered = false;
+    return;
+  }
+  Source.Position = Space3DUnreal::GetScaleFactor() * Position;
+  Source.Volume = Volume;
+  int32 Start = (int32)(WritePos & HistoryMask);
+  int32 First = FMath::Min(BufLength, HistoryMask + 1 - Start);
+  FMemory::Memcpy(Source.History.GetData() + Start, Audio, First * sizeof(float));
+  FMemory::Memcpy(Source.History.GetData(), Audio + First, (BufLength - First) * sizeof(float));
+}
+
+void FSpace3DUnrealDryPath::EndBuffer()
+{
+  WritePos += BufLength;
+}
+
+void FSpace3DUnrealDryPath::SnapshotSinks(uint64_t T)
+{
+  if(!bEnabled) return;
+  FSinkSet& Set = SinkSets[WriteSinks];
+  TArray<FSink>& Sinks = Set.Sinks;
+  Sinks.Reset();
+  for(size_t h=0; h<Space3D::HeadCount() && Sinks.Num() < MaxSinks; ++h)
+  {
+    uint64_t uuid = Space3D::HeadByIndex(h);
+    FSink Sink;
+    Sink.Type = ESinkType::Head;
+    Sink.Channel = (int32)Space3D::HeadChannelOf(uuid);
+    Sink.Position = G2UV(Space3D::POf(uuid, T));
+    Sink.Right = G2UV(Space3D::ROf(uuid, T) * glm::vec3(0.0f, 1.0f, 0.0f)); //Unreal's right axis
+    Sinks.Add(Sink);
+  }
+  for(size_t m=0; m<Space3D::MicCount() && Sinks.Num() < MaxSinks; ++m)
+  {
+    uint64_t uuid = Space3D::MicByIndex(m);
+    FSink Sink;
+    Sink.Type = ESinkType::Mic;
+    Sink.Channel = (int32)Space3D::MicChannelOf(uuid);
+    Sink.Position = G2UV(Space3D::POf(uuid, T));
+    Sink.Right = FVector::ZeroVector;
+    Sinks.Add(Sink);
+  }
+  if(Space3D::SpeakerCount() > 0)
+  {
+    //Speakers and listener are in the physical room, which is mapped into the world
+    glm::mat4 Room = Space3D::TOf(Space3D::Room(), T);
+    Set.ListenerPosition = G2UV(glm::vec3(Room * glm::vec4(Space3D::POf(Space3D::Listener(), T), 1.0f)));
+    for(size_t s=0; s<Space3D::SpeakerCount() && Sinks.Num() < MaxSinks; ++s)
+    {
+      uint64_t uuid = Space3D::SpeakerByIndex(s);
+      FSink Sink;
+      Sink.Type = ESinkType::Speaker;
+      Sink.Channel = (int32)Space3D::SpeakerChannelOf(uuid);
+      Sink.Position = G2UV(glm::vec3(Room * glm::vec4(Space3D::POf(uuid, T), 1.0f)));
+      Sink.Right = FVector::ZeroVector;
+      Sinks.Add(Sink);
+    }
+  }
+  WriteSinks = LatestSinks.exchange(WriteSinks | NewSinks, std::memory_order_acq_rel) & ~NewSinks;
+}
+
+void FSpace3DUnrealDryPath::AcquireSinks()
+{
+  if((LatestSinks.load(std::memory_order_relaxed) & NewSinks) == 0) return;
+  ReadSinks = LatestSinks.exchange(ReadSinks, std::memory_order_acq_rel) & ~NewSinks;
+}
+
+void FSpace3DUnrealDryPath::ComputeGains(const FVector& Position, float Volume, float* OutGains, float& OutDelay) const
+{
+  FMemory::Memzero(OutGains, Channels * sizeof(float));
+  const TArray<FSink>& Sinks = SinkSets[ReadSinks].Sinks;
+  const FVector& ListenerPosition = SinkSets[ReadSinks].ListenerPosition;
+  float Nearest = MAX_FLT;
+  float SpeakerPower = 0.0f;
+  bool bSpeakers = false;
+  for(const FSink& Sink : Sinks)
+  {
+    if(Sink.Type == ESinkType::Speaker)
+    {
+      bSpeakers = true;
+      continue;
+    }
+    FVector Dir = Position - Sink.Position;
+    float Dist = Dir.Size();
+    Nearest = FMath::Min(Nearest, Dist);
+    //Inverse distance law, flat within 1 m
+    float Gain = Volume / FMath::Max(Dist, 1.0f);
+    if(Sink.Type == ESinkType::Mic)
+    {
+      if(Sink.Channel < Channels) OutGains[Sink.Channel] += Gain;
+      continue;
+    }
+    float x = Dist > KINDA_SMALL_NUMBER ? HeadPanWidth * FMath::Clamp(FVector::DotProduct(Dir / Dist, Sink.Right), -1.0f, 1.0f) : 0.0f;
+    if(Sink.Channel < Channels) OutGains[Sink.Channel] += Gain * FMath::Sqrt(0.5f * (1.0f - x));
+    if(Sink.Channel + 1 < Channels) OutGains[Sink.Channel + 1] += Gain * FMath::Sqrt(0.5f * (1.0f + x));
+  }
+  if(bSpeakers)
+  {
+    //Pan over all speakers with a sharpened cardioid around the source's direction from the listener, then normalize to constant power
+    FVector Dir = Position - ListenerPosition;
+    float Dist = Dir.Size();
+    Nearest = FMath::Min(Nearest, Dist);
+    FVector SrcDir = Dist > KINDA_SMALL_NUMBER ? Dir / Dist : FVector::ZeroVector;
+    for(const FSink& Sink : Sinks)
+    {
+      if(Sink.Type != ESinkType::Speaker || Sink.Channel >= Channels) continue;
+      FVector SpkDir = (Sink.Position - ListenerPosition).GetSafeNormal();
+      float w = 0.5f * (1.0f + FVector::DotProduct(SrcDir, SpkDir));
+      w = w * w * w * w;
+      OutGains[Sink.Channel] += w;
+      SpeakerPower += w * w;
+    }
+    if(SpeakerPower > 0.0f)
+    {
+      float Norm = Volume / FMath::Max(Dist, 1.0f) / FMath::Sqrt(SpeakerPower);
+      for(const FSink& Sink : Sinks)
+      {
+        if(Sink.Type == ESinkType::Speaker && Sink.Channel < Channels) OutGains[Sink.Channel] *= Norm;
+      }
+    }
+  }
+  OutDelay = Nearest < MAX_FLT ? FMath::Min(Nearest / SpeedOfSound * Rate, MaxDelay) : 0.0f;
+}
+
+bool FSpace3DUnrealDryPath::HasActiveSources() const
+{
+  for(const FSource& Source : Sources)
+  {
+    if(Source.bActive) return true;
+  }
+  return false;
+}
+
+bool FSpace3DUnrealDryPath::Render(int32 NumOutChannels, int32 NumFrames)
+{
+  bool bAny = false;
+  FMemory::Memzero(Scratch.GetData(), NumOutChannels * NumFrames * sizeof(float));
+  float Step = 1.0f / (float)NumFrames;
+  int64 Base = WritePos - NumFrames;
+  for(FSource& Source : Sources)
+  {
+    if(!Source.bActive) continue;
+    float NewDelay;
+    ComputeGains(Source.Position, Source.Volume, TargetGains.GetData(), NewDelay);
+    if(!Source.bRendered)
+    {
+      //Start from where the source is rather than gliding in
+      FMemory::Memcpy(Source.Gains.GetData(), TargetGains.GetData(), Channels * sizeof(float));
+      Source.Delay = NewDelay;
+    }
+
+    //Delay line, with the delay moving linearly over the buffer
+    const float* History = Source.History.GetData();
+    for(int32 n=0; n<NumFrames; ++n)
+    {
+      float d = Source.Delay + (NewDelay - Source.Delay) * (float)(n + 1) * Step;
+      double Pos = (double)(Base + n) - (double)d;
+      int64 i = (int64)FMath::FloorToDouble(Pos);
+      float f = (float)(Pos - (double)i);
+      Delayed[n] = History[i & HistoryMask] * (1.0f - f) + History[(i + 1) & HistoryMask] * f;
+    }
+
+    for(int32 c=0; c<NumOutChannels; ++c)
+    {
+      float g0 = Source.Gains[c], g1 = TargetGains[c];
+      if(g0 == 0.0f && g1 == 0.0f) continue;
+      float dg = (g1 - g0) * Step;
+      float* Out = Scratch.GetData() + c;
+      for(int32 n=0; n<NumFrames; ++n)
+      {
+        Out[n * NumOutChannels] += (g0 + dg * (float)(n + 1)) * Delayed[n];
+      }
+    }
+    FMemory::Memcpy(Source.Gains.GetData(), TargetGains.GetData(), Channels * sizeof(float));
+    Source.Delay = NewDelay;
+    Source.bRendered = true;
+    bAny = true;
+  }
+  return bAny;
+}
+
+void FSpace3DUnrealDryPath::Mix(float* Out, int32 NumOutChannels, int32 NumFrames, int32 NumWet)
+{
+  if(!bEnabled || NumFrames != BufLength || NumOutChannels > Channels)
+  {
+    WetMix = 1.0f;
+    return;
+  }
+
+  if(NumWet < NumFrames && !HasActiveSources())
+  {
+    //Nothing playing and nothing queued is silence, not a stall
+    for(FSource& Source : Sources) Source.bRendered = false;
+    GoodBuffers = 0;
+    WetMix = 1.0f;
+    return;
+  }
+
+  //Watchdog: a Process call still running well past its deadline means the next frames will not arrive in time, so fade out before the queue runs dry
+  bool bStalled = Space3DUnreal::GetProcessInFlightFrames() > DeadlineFrames;
+  float Start = WetMix;
+  if(NumWet < NumFrames || bStalled)
+  {
+    GoodBuffers = 0;
+    WetMix = 0.0f;
+  }
+  else if(++GoodBuffers > RecoverBuffers)
+  {
+    WetMix = FMath::Min(WetMix + FadeStep, 1.0f);
+  }
+  if(Start >= 1.0f && WetMix >= 1.0f)
+  {
+    for(FSource& Source : Sources) Source.bRendered = false;
+    return;
+  }
+
+  AcquireSinks();
+  if(Render(NumOutChannels, NumFrames)) FallbackBuffers.fetch_add(1, std::memory_order_relaxed);
+  //Equal-power crossfade over the Space3D audio we have; past an underrun there is only the dry path
+  int32 RampLength = FMath::Max(FMath::Min(NumWet, NumFrames), 1);
+  for(int32 n=0; n<NumFrames; ++n)
+  {
+    float w = n < RampLength ? Start + (WetMix - Start) * (float)(n + 1) / (float)RampLength : WetMix;
+    float GainWet = FMath::Sin(w * HALF_PI);
+    float GainDry = FMath::Cos(w * HALF_PI);
+    float* Frame = Out + n * NumOutChannels;
+    const float* Dry = Scratch.GetData() + n * NumOutChannels;
+    for(int32 c=0; c<NumOutChannels; ++c)
+    {
+      Frame[c] = Frame[c] * GainWet + Dry[c] * GainDry;
+    }
+  }
+}
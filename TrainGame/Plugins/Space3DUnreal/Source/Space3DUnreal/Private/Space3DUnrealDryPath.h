@@ -0,0 +1,98 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include <atomic>
+
+/**
+Emergency direct-path renderer, used by the output submix when Space3D cannot deliver a frame in time (e.g. the GPU stalls on a shader compile or a large geometry upload). Instead of dropping out, the output crossfades to a cheap CPU rendering of each source's direct path only: distance gain, propagation delay and simple panning to the heads, mics and speakers in the scene. Once Space3D is keeping up again, it crossfades back.
+
+Each buffer, the spatializer stages every source's mono input and position (SetSource) and ends the buffer (EndBuffer); the output submix then calls Mix with whatever Space3D audio it got. Both run on the audio render thread, one after the other, so none of that is locked. The heads, mics and speakers are snapshotted by whoever runs Space3D, after each frame it writes to Space3D (SnapshotSinks), and handed to the audio render thread through a triple buffer. Neither the spatializer nor Mix takes the Space3D API lock, so the dry path keeps working while Process, a mesh upload or a command buffer commit holds it, with the sinks where they were last seen. (Without the render worker, Space3D runs on the audio render thread itself, so a stall there stalls the output too.)
+
+All storage is allocated in Configure(), never while running.
+*/
+class FSpace3DUnrealDryPath
+{
+public:
+  FSpace3DUnrealDryPath();
+
+  /** (Re)allocates for NumSlots sources, buffers of BufferLength at SampleRate, and up to NumChannels output channels. */
+  void Configure(int32 NumSlots, int32 BufferLength, float SampleRate, int32 NumChannels);
+  /** Set from the output preset. DeadlineFrames: how long a Process call may run, in frame lengths, before Space3D counts as stalled. */
+  void SetConfig(bool bInEnabled, float InDeadlineFrames, float InCrossfadeMs);
+  bool IsEnabled() const { return bEnabled; }
+
+  /** Spatializer: stages this buffer's BufferLength samples of mono input for a slot (nullptr = not playing), its position in Unreal units and its volume. */
+  void SetSource(int32 Slot, const float* Audio, const FVector& Position, float Volume);
+  /** Spatializer: ends the buffer begun by SetSource. */
+  void EndBuffer();
+  /** Whoever runs Space3D, holding the Space3D API lock: snapshots the heads, mics, speakers and listener as of time T for the audio render thread. */
+  void SnapshotSinks(uint64_t T);
+
+  /** Output submix: Out holds NumFrames of interleaved Space3D output, of which the first NumWet frames are real audio. Crossfades to or from the dry path as needed. */
+  void Mix(float* Out, int32 NumOutChannels, int32 NumFrames, int32 NumWet);
+
+  /** Any thread. Number of output buffers in which the dry path played any sources. */
+  uint32 NumFallbackBuffers() const { return FallbackBuffers.load(std::memory_order_relaxed); }
+
+private:
+  struct FSource
+  {
+    /** Ring buffer of past input, for the propagation delay. */
+    TArray<float> History;
+    /** Per output channel gain at the end of the last rendered buffer. */
+    TArray<float> Gains;
+    FVector Position;
+    float Volume;
+    /** Propagation delay at the end of the last rendered buffer, in samples. */
+    float Delay;
+    bool bActive, bRendered;
+  };
+
+  enum class ESinkType : uint8 { Head, Mic, Speaker };
+
+  struct FSink
+  {
+    ESinkType Type;
+    int32 Channel;
+    FVector Position;
+    /** Heads only: direction of the right ear. */
+    FVector Right;
+  };
+
+  /** Crossfade step per buffer, for the current crossfade length, buffer size and rate. */
+  void UpdateFadeStep();
+  bool HasActiveSources() const;
+  /** Renders all active sources into Scratch, interleaved. Returns false if there were none. */
+  bool Render(int32 NumOutChannels, int32 NumFrames);
+  /** Per channel gains and the propagation delay for a source at Position. */
+  void ComputeGains(const FVector& Position, float Volume, float* OutGains, float& OutDelay) const;
+
+  struct FSinkSet
+  {
+    TArray<FSink> Sinks;
+    /** Speakers are panned relative to the listener. */
+    FVector ListenerPosition;
+  };
+
+  /** Takes the latest set of sinks from SnapshotSinks, if there is a new one. */
+  void AcquireSinks();
+
+  TArray<FSource> Sources;
+  /** Triple buffer of sinks: one being written by SnapshotSinks, one being read by Mix, and the latest one, which LatestSinks holds along with NewSinks if Mix has not taken it yet. */
+  FSinkSet SinkSets[3];
+  int32 WriteSinks, ReadSinks;
+  std::atomic<int32> LatestSinks;
+  TArray<float> Scratch, Delayed, TargetGains;
+  int32 BufLength, Channels, HistoryMask;
+  int64 WritePos;
+  float Rate, MaxDelay;
+
+  bool bEnabled;
+  float DeadlineFrames, CrossfadeMs, FadeStep;
+  /** Share of Space3D output in the mix: 1 = Space3D only, 0 = dry only. */
+  float WetMix;
+  int32 GoodBuffers;
+
+  std::atomic<uint32> FallbackBuffers;
+};
@@ -0,0 +1,177 @@
+#include "Space3DUnrealFrameQueue.h"
+#include "Space3DUnrealDSP.h"
+
+FSpace3DUnrealFrameQueue::FSpace3DUnrealFrameQueue() : Backlog(2)
+{
+  Configure(0, 1, 1);
+}
+
+void FSpace3DUnrealFrameQueue::SetMaxBacklog(int32 Buffers)
+{
+  Backlog = FMath::Clamp(Buffers, 1, MaxBacklogBuffers);
+  BacklogFrames = (PrimeSamples + (Backlog - 1) * BufLength + Length - 1) / Length;
+}
+
+void FSpace3DUnrealFrameQueue::Configure(int32 InNumChannels, int32 InFrameLength, int32 InBufferLength, bool bVariableLength)
+{
+  check(InFrameLength > 0 && InBufferLength > 0);
+  Channels = InNumChannels;
+  Length = InFrameLength;
+  BufLength = InBufferLength;
+  //Buffers are read at multiples of BufLength and frames arrive at multiples of Length, so the two can be out of step by up to Length - gcd
+  PrimeSamples = BufLength + Length - (bVariableLength ? 0 : FMath::GreatestCommonDivisor(BufLength, Length));
+  //Room for the largest backlog, plus a buffer's worth of frames rendered before the consumer runs and one being written
+  Capacity = (PrimeSamples + MaxBacklogBuffers * BufLength + Length - 1) / Length + (BufLength + Length - 1) / Length + 1;
+  Frames.Empty();
+  Frames.AddDefaulted(Capacity);
+  for(int32 f=0; f<Capacity; ++f)
+  {
+    Frames[f].Audio.SetNumZeroed(Channels * Length);
+    Frames[f].NumSamples = Length;
+    Frames[f].Seq = Frames[f].AudioT = 0;
+  }
+  SetMaxBacklog(Backlog);
+  WriteIdx.store(0);
+  ReadIdx.store(0);
+  bHolding = bStarted = bPrimed = bExpected = false;
+  bExpectInput.store(false);
+  Current = nullptr;
+  Cursor = 0;
+  LastSeq = LastAudioT = 0;
+  NumRendered.store(0);
+  NumPlayed.store(0);
+  NumDropped.store(0);
+  NumLate.store(0);
+  NumDuplicates.store(0);
+}
+
+float* FSpace3DUnrealFrameQueue::BeginWrite()
+{
+  uint64_t W = WriteIdx.load(std::memory_order_relaxed);
+  if(W - ReadIdx.load(std::memory_order_acquire) >= (uint64_t)Capacity)
+  {
+    NumDropped.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+  return Frames[(int32)(W % Capacity)].Audio.GetData();
+}
+
+void FSpace3DUnrealFrameQueue::EndWrite(uint64_t Seq, uint64_t AudioT, int32 NumSamples)
+{
+  check(NumSamples <= Length);
+  uint64_t W = WriteIdx.load(std::memory_order_relaxed);
+  FFrame& Frame = Frames[(int32)(W % Capacity)];
+  Frame.NumSamples = NumSamples;
+  Frame.Seq = Seq;
+  Frame.AudioT = AudioT;
+  NumRendered.fetch_add(1, std::memory_order_relaxed);
+  WriteIdx.store(W + 1, std::memory_order_release);
+}
+
+const FSpace3DUnrealFrameQueue::FFrame* FSpace3DUnrealFrameQueue::Consume()
+{
+  uint64_t R = ReadIdx.load(std::memory_order_relaxed);
+  if(bHolding)
+  {
+    ReadIdx.store(++R, std::memory_order_release);
+    bHolding = false;
+  }
+  uint64_t W = WriteIdx.load(std::memory_order_acquire);
+  
+  //Catch up if frames piled up behind a late one
+  while(W - R > (uint64_t)BacklogFrames)
+  {
+    LastSeq = Frames[(int32)(R % Capacity)].Seq;
+    LastAudioT = Frames[(int32)(R % Capacity)].AudioT;
+    ReadIdx.store(++R, std::memory_order_release);
+    NumDropped.fetch_add(1, std::memory_order_relaxed);
+  }
+  
+  while(R != W)
+  {
+    const FFrame& Frame = Frames[(int32)(R % Capacity)];
+    if(bStarted && Frame.AudioT <= LastAudioT)
+    {
+      //Same audio time processed twice (or clock went backwards); playing it again would repeat audio
+      NumDuplicates.fetch_add(1, std::memory_order_relaxed);
+      ReadIdx.store(++R, std::memory_order_release);
+      continue;
+    }
+    if(bStarted && Frame.Seq > LastSeq + 1)
+    {
+      NumDropped.fetch_add((uint32)(Frame.Seq - LastSeq - 1), std::memory_order_relaxed);
+    }
+    bStarted = true;
+    bHolding = true;
+    LastSeq = Frame.Seq;
+    LastAudioT = Frame.AudioT;
+    NumPlayed.fetch_add(1, std::memory_order_relaxed);
+    return &Frame;
+  }
+  
+  if(bStarted && bExpected) NumLate.fetch_add(1, std::memory_order_relaxed);
+  return nullptr;
+}
+
+int32 FSpace3DUnrealFrameQueue::Read(float* Out, int32 NumOutChannels, int32 NumFrames)
+{
+  check(NumOutChannels <= Channels);
+  //Running dry with no input pushed is just the quiet between sounds
+  bExpected = bExpectInput.exchange(false, std::memory_order_relaxed);
+  if(!bPrimed)
+  {
+    uint64_t R = ReadIdx.load(std::memory_order_relaxed);
+    uint64_t W = WriteIdx.load(std::memory_order_acquire);
+    int32 Ready = 0;
+    for(uint64_t i=R; i!=W; ++i)
+    {
+      Ready += Frames[(int32)(i % Capacity)].NumSamples;
+    }
+    if(bHolding) Ready -= (Current != nullptr ? Cursor : Frames[(int32)(R % Capacity)].NumSamples);
+    if(Ready < PrimeSamples)
+    {
+      if(bStarted && bExpected) NumLate.fetch_add(1, std::memory_order_relaxed);
+      FMemory::Memzero(Out, NumOutChannels * NumFrames * sizeof(float));
+      return 0;
+    }
+    bPrimed = true;
+  }
+  
+  int32 Done = 0;
+  while(Done < NumFrames)
+  {
+    if(Current == nullptr)
+    {
+      Current = Consume();
+      Cursor = 0;
+      if(Current == nullptr)
+      {
+        //Underrun; wait until we are primed again rather than stuttering from frame to frame
+        bPrimed = false;
+        break;
+      }
+    }
+    int32 n = FMath::Min(NumFrames - Done, Current->NumSamples - Cursor);
+    Space3DUnreal::Interleave(Current->Audio.GetData() + Cursor, Length, Out + Done * NumOutChannels, n, NumOutChannels);
+    Cursor += n;
+    Done += n;
+    if(Cursor == Current->NumSamples) Current = nullptr; //Released by the next Consume()
+  }
+  if(Done < NumFrames)
+  {
+    FMemory::Memzero(Out + Done * NumOutChannels, NumOutChannels * (NumFrames - Done) * sizeof(float));
+  }
+  return Done;
+}
+
+FSpace3DUnrealFrameQueue::FStats FSpace3DUnrealFrameQueue::GetStats() const
+{
+  FStats Stats;
+  Stats.Rendered = NumRendered.load(std::memory_order_relaxed);
+  Stats.Played = NumPlayed.load(std::memory_order_relaxed);
+  Stats.Dropped = NumDropped.load(std::memory_order_relaxed);
+  Stats.Late = NumLate.load(std::memory_order_relaxed);
+  Stats.Duplicates = NumDuplicates.load(std::memory_order_relaxed);
+  Stats.Depth = (uint32)(WriteIdx.load(std::memory_order_relaxed) - ReadIdx.load(std::memory_order_relaxed));
+  return Stats;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include <atomic>
+
+/**
+Single-producer, single-consumer queue of rendered Space3D output frames, from whoever runs Space3D::Process (the spatializer's OnAllSourcesProcessed, or the render worker) to the Space3D output submix.
+
+Each frame carries a sequence number and the audio clock it was processed as of. The consumer uses these to detect gaps (frames that were never rendered or did not fit in the queue) and duplicates (the same audio time processed twice).
+
+Frames are Space3D's frame length, which need not match the engine's buffer size: Read() fills each output buffer from as many frames as it takes, carrying the rest of a frame over to the next buffer. Before it starts (and after any underrun), Read() waits until enough audio is queued that frames of one length can always cover buffers of the other. When the queue runs dry it outputs silence, and counts the buffer as late if input was pushed for it (see ExpectInput()); the late frame is played afterwards instead of being discarded, and if the backlog grows beyond MaxBacklog() buffers the oldest frames are skipped to catch up.
+
+All frame storage is allocated in Configure(), never while running.
+*/
+class FSpace3DUnrealFrameQueue
+{
+public:
+  struct FFrame
+  {
+    /** Planar audio, NumChannels() channels of FrameLength() samples, of which the first NumSamples are used. */
+    TArray<float> Audio;
+    int32 NumSamples;
+    uint64_t Seq;
+    uint64_t AudioT;
+  };
+  
+  struct FStats
+  {
+    uint32 Rendered, Played, Dropped, Late, Duplicates, Depth;
+  };
+  
+  static constexpr int32 MaxBacklogBuffers = 3;
+  
+  FSpace3DUnrealFrameQueue();
+  
+  /** (Re)allocates the frames and resets the queue. InFrameLength is the longest frame; frames are all that long unless bVariableLength (when Space3D's output is resampled). InBufferLength is the engine buffer size the consumer reads. Must not be called while a producer or consumer is running. */
+  void Configure(int32 InNumChannels, int32 InFrameLength, int32 InBufferLength, bool bVariableLength = false);
+  
+  int32 NumChannels() const { return Channels; }
+  int32 FrameLength() const { return Length; }
+  
+  /** Consumer: number of engine buffers of audio allowed to wait in the queue before the oldest frames are skipped (1 to MaxBacklogBuffers). */
+  void SetMaxBacklog(int32 Buffers);
+  int32 MaxBacklog() const { return Backlog; }
+  
+  /** Producer: returns the planar buffer to render the next frame into, or nullptr if the queue is full (the frame is then counted as dropped). */
+  float* BeginWrite();
+  /** Producer: publishes the first NumSamples samples of the frame returned by the last successful BeginWrite(). */
+  void EndWrite(uint64_t Seq, uint64_t AudioT, int32 NumSamples);
+  
+  /** Any thread: input was pushed for the current engine buffer, so if the next Read() runs dry the buffer is late rather than simply idle (no sources playing). */
+  void ExpectInput() { bExpectInput.store(true, std::memory_order_relaxed); }
+  
+  /** Consumer: writes NumFrames of interleaved NumOutChannels audio (at most NumChannels()) to Out, silence wherever no rendered audio is available. Returns the number of frames of rendered audio, which always come first. */
+  int32 Read(float* Out, int32 NumOutChannels, int32 NumFrames);
+  
+  /** Any thread. */
+  FStats GetStats() const;
+  
+private:
+  /** Releases the previously consumed frame and returns the next one to play, or nullptr if none is ready. The frame stays valid until the next call. */
+  const FFrame* Consume();
+  
+  TArray<FFrame> Frames;
+  int32 Channels, Length, BufLength, Capacity, Backlog, BacklogFrames;
+  /** Samples which must be queued before playback (re)starts: BufLength + Length - gcd(BufLength, Length), or BufLength + Length for variable length frames. */
+  int32 PrimeSamples;
+  
+  std::atomic<uint64_t> WriteIdx, ReadIdx;
+  bool bHolding, bStarted, bPrimed, bExpected;
+  std::atomic<bool> bExpectInput;
+  const FFrame* Current;
+  int32 Cursor;
+  uint64_t LastSeq, LastAudioT;
+  
+  std::atomic<uint32> NumRendered, NumPlayed, NumDropped, NumLate, NumDuplicates;
+};
@@ -0,0 +1,245 @@
+#include "Space3DUnrealGeometryCache.h"
+#include "Space3DUnreal.h"
+#include "Async/MappedFileHandle.h"
+#include "Engine/StaticMesh.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "PhysicsEngine/BodySetup.h"
+
+#if WITH_EDITOR
+#include "DerivedDataCacheInterface.h"
+#endif
+
+namespace
+{
+  /** Bump whenever the blob layout or the way geometry is built changes, so old entries are not used. */
+  constexpr uint32 FormatVersion = 1;
+  constexpr uint32 BlobMagic = 0x47443353; //"S3DG"
+  /** Every section of a blob starts on this alignment, so mapped data can be used in place. */
+  constexpr int64 BlobAlignment = 16;
+  constexpr uint32 MaxLODs = 8;
+
+  struct FBlobHeader
+  {
+    uint32 Magic, Version, NumLODs, Pad;
+  };
+
+  struct FBlobLOD
+  {
+    int32 NumVertices, NumIndices;
+    uint32 bNormals, Pad;
+  };
+
+  FString CookedPath(const FString& Key)
+  {
+    return FPaths::ProjectContentDir() / TEXT("Space3D/Geometry") / Key + TEXT(".s3dgeo");
+  }
+
+#if !UE_BUILD_SHIPPING
+  bool IsCooking()
+  {
+    return FParse::Param(FCommandLine::Get(), TEXT("Space3DCookGeometry"));
+  }
+
+  bool WriteCooked(const FString& Key, const TArray<uint8>& Blob)
+  {
+    //Written under a temporary name first, so a cooked file is always whole even with several tasks writing it
+    FString Path = CookedPath(Key);
+    FString Temp = Path + TEXT(".") + FGuid::NewGuid().ToString() + TEXT(".tmp");
+    if(FFileHelper::SaveArrayToFile(Blob, *Temp) && IFileManager::Get().Move(*Path, *Temp, true))
+    {
+      UE_LOG(LogSpace3DUnreal, Log, TEXT("Cooked acoustic geometry %s"), *Path);
+      return true;
+    }
+    UE_LOG(LogSpace3DUnreal, Warning, TEXT("Could not write cooked acoustic geometry %s"), *Path);
+    IFileManager::Get().Delete(*Temp, false, false, true);
+    return false;
+  }
+#endif
+
+#if WITH_EDITOR
+  FString DDCKey(const FString& Key)
+  {
+    return FDerivedDataCacheInterface::BuildCacheKey(TEXT("S3DGEO"), *FString::Printf(TEXT("%u"), FormatVersion), *Key);
+  }
+#endif
+}
+
+FSpace3DUnrealCookedGeometry::FSpace3DUnrealCookedGeometry() {}
+
+FSpace3DUnrealCookedGeometry::~FSpace3DUnrealCookedGeometry()
+{
+  //Views first, then what they point into
+  LODs.Empty();
+  MappedRegion.Reset();
+  MappedHandle.Reset();
+}
+
+void FSpace3DUnrealCookedGeometry::AddLOD(TArray<FVector>&& Vertices, TArray<FVector>&& Normals, TArray<int32>&& Indices)
+{
+  //Moving an array keeps its allocation, so the views stay valid as more are added
+  FLOD& LOD = LODs.AddDefaulted_GetRef();
+  LOD.NumVertices = Vertices.Num();
+  LOD.NumIndices = Indices.Num();
+  LOD.Vertices = OwnedVectors.Add_GetRef(MoveTemp(Vertices)).GetData();
+  LOD.Normals = Normals.Num() == LOD.NumVertices && LOD.NumVertices > 0 ? OwnedVectors.Add_GetRef(MoveTemp(Normals)).GetData() : nullptr;
+  LOD.Indices = OwnedIndices.Add_GetRef(MoveTemp(Indices)).GetData();
+}
+
+void FSpace3DUnrealCookedGeometry::Serialize(TArray<uint8>& OutBlob) const
+{
+  OutBlob.Reset();
+  auto Append = [&OutBlob](const void* Data, int64 Bytes)
+  {
+    int32 At = OutBlob.AddUninitialized((int32)Bytes);
+    FMemory::Memcpy(OutBlob.GetData() + At, Data, Bytes);
+    OutBlob.AddZeroed((int32)(Align((int64)OutBlob.Num(), BlobAlignment) - OutBlob.Num()));
+  };
+  FBlobHeader Header = { BlobMagic, FormatVersion, (uint32)LODs.Num(), 0 };
+  Append(&Header, sizeof(Header));
+  for(const FLOD& LOD : LODs)
+  {
+    FBlobLOD BlobLOD = { LOD.NumVertices, LOD.NumIndices, LOD.Normals != nullptr ? 1u : 0u, 0 };
+    Append(&BlobLOD, sizeof(BlobLOD));
+  }
+  for(const FLOD& LOD : LODs)
+  {
+    Append(LOD.Vertices, LOD.NumVertices * sizeof(FVector));
+    if(LOD.Normals != nullptr) Append(LOD.Normals, LOD.NumVertices * sizeof(FVector));
+    Append(LOD.Indices, LOD.NumIndices * sizeof(int32));
+  }
+}
+
+bool FSpace3DUnrealCookedGeometry::Parse(const uint8* Data, int64 Size)
+{
+  LODs.Reset();
+  int64 At = 0;
+  auto Take = [Data, Size, &At](int64 Bytes) -> const uint8*
+  {
+    if(Bytes < 0 || At + Bytes > Size) return nullptr;
+    const uint8* Section = Data + At;
+    At = Align(At + Bytes, BlobAlignment);
+    return Section;
+  };
+  const FBlobHeader* Header = (const FBlobHeader*)Take(sizeof(FBlobHeader));
+  if(Header == nullptr || Header->Magic != BlobMagic || Header->Version != FormatVersion) return false;
+  if(Header->NumLODs == 0 || Header->NumLODs > MaxLODs) return false;
+  const FBlobLOD* BlobLODs = (const FBlobLOD*)Take(Header->NumLODs * sizeof(FBlobLOD));
+  if(BlobLODs == nullptr) return false;
+  for(uint32 l=0; l<Header->NumLODs; ++l)
+  {
+    const FBlobLOD& BlobLOD = BlobLODs[l];
+    if(BlobLOD.NumVertices <= 0 || BlobLOD.NumIndices <= 0 || BlobLOD.NumIndices % 3 != 0) return false;
+    FLOD& LOD = LODs.AddDefaulted_GetRef();
+    LOD.NumVertices = BlobLOD.NumVertices;
+    LOD.NumIndices = BlobLOD.NumIndices;
+    LOD.Vertices = (const FVector*)Take((int64)LOD.NumVertices * sizeof(FVector));
+    LOD.Normals = BlobLOD.bNormals ? (const FVector*)Take((int64)LOD.NumVertices * sizeof(FVector)) : nullptr;
+    LOD.Indices = (const int32*)Take((int64)LOD.NumIndices * sizeof(int32));
+    if(LOD.Vertices == nullptr || (BlobLOD.bNormals && LOD.Normals == nullptr) || LOD.Indices == nullptr) return false;
+    //A bad index would take Space3D down, so the indices are the one thing read through
+    for(int32 i=0; i<LOD.NumIndices; ++i)
+    {
+      if((uint32)LOD.Indices[i] >= (uint32)LOD.NumVertices) return false;
+    }
+  }
+  return true;
+}
+
+FString FSpace3DUnrealGeometryCache::MakeKey(const UStaticMesh& Mesh, int32 ProxyTriangles, int32 NumLODs, float FeatureAngle)
+{
+  const UBodySetup* BodySetup = Mesh.BodySetup;
+  if(BodySetup == nullptr || !BodySetup->BodySetupGuid.IsValid()) return FString();
+  if(ProxyTriangles <= 0)
+  {
+    //Not simplified, so the other settings make no difference
+    NumLODs = 1;
+    FeatureAngle = 0.0f;
+  }
+  return FString::Printf(TEXT("%s_%d_%d_%d_V%u"), *BodySetup->BodySetupGuid.ToString(), FMath::Max(ProxyTriangles, 0), NumLODs, FMath::RoundToInt(FeatureAngle * 100.0f), FormatVersion);
+}
+
+bool FSpace3DUnrealGeometryCache::IsCached(const FString& Key)
+{
+  if(Key.IsEmpty()) return false;
+  if(FPlatformFileManager::Get().GetPlatformFile().FileExists(*CookedPath(Key))) return true;
+#if WITH_EDITOR
+  return GetDerivedDataCacheRef().CachedDataProbablyExists(*DDCKey(Key));
+#else
+  return false;
+#endif
+}
+
+#if WITH_EDITOR
+bool FSpace3DUnrealGeometryCache::IsCooked(const FString& Key)
+{
+  return !Key.IsEmpty() && FPlatformFileManager::Get().GetPlatformFile().FileExists(*CookedPath(Key));
+}
+
+bool FSpace3DUnrealGeometryCache::Cook(const FString& Key, const FSpace3DUnrealCookedGeometry& Geometry)
+{
+  if(Key.IsEmpty()) return false;
+  TArray<uint8> Blob;
+  Geometry.Serialize(Blob);
+  return WriteCooked(Key, Blob);
+}
+#endif
+
+TSharedPtr<FSpace3DUnrealCookedGeometry, ESPMode::ThreadSafe> FSpace3DUnrealGeometryCache::Find(const FString& Key)
+{
+  if(Key.IsEmpty()) return nullptr;
+  TSharedPtr<FSpace3DUnrealCookedGeometry, ESPMode::ThreadSafe> Geometry = MakeShared<FSpace3DUnrealCookedGeometry, ESPMode::ThreadSafe>();
+
+  //Cooked with the game: mapped, and used in place
+  FString Path = CookedPath(Key);
+  IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+  if(PlatformFile.FileExists(*Path))
+  {
+    bool bParsed = false;
+    Geometry->MappedHandle.Reset(PlatformFile.OpenMapped(*Path));
+    if(Geometry->MappedHandle.IsValid())
+    {
+      Geometry->MappedRegion.Reset(Geometry->MappedHandle->MapRegion(0, Geometry->MappedHandle->GetFileSize()));
+      bParsed = Geometry->MappedRegion.IsValid() && Geometry->Parse(Geometry->MappedRegion->GetMappedPtr(), Geometry->MappedRegion->GetMappedSize());
+    }
+    else if(FFileHelper::LoadFileToArray(Geometry->OwnedBlob, *Path))
+    {
+      //Platform without memory mapping
+      bParsed = Geometry->Parse(Geometry->OwnedBlob.GetData(), Geometry->OwnedBlob.Num());
+    }
+    if(bParsed) return Geometry;
+    UE_LOG(LogSpace3DUnreal, Warning, TEXT("Ignoring invalid cooked acoustic geometry %s"), *Path);
+    Geometry = MakeShared<FSpace3DUnrealCookedGeometry, ESPMode::ThreadSafe>();
+  }
+
+#if WITH_EDITOR
+  if(GetDerivedDataCacheRef().GetSynchronous(*DDCKey(Key), Geometry->OwnedBlob, TEXT("Space3DGeometry")))
+  {
+    if(Geometry->Parse(Geometry->OwnedBlob.GetData(), Geometry->OwnedBlob.Num()))
+    {
+      if(IsCooking()) WriteCooked(Key, Geometry->OwnedBlob);
+      return Geometry;
+    }
+    UE_LOG(LogSpace3DUnreal, Warning, TEXT("Ignoring invalid acoustic geometry %s in the derived data cache"), *Key);
+  }
+#endif
+  return nullptr;
+}
+
+void FSpace3DUnrealGeometryCache::Store(const FString& Key, const FSpace3DUnrealCookedGeometry& Geometry)
+{
+  if(Key.IsEmpty()) return;
+#if !UE_BUILD_SHIPPING
+  TArray<uint8> Blob;
+  Geometry.Serialize(Blob);
+#endif
+#if WITH_EDITOR
+  GetDerivedDataCacheRef().Put(*DDCKey(Key), Blob, TEXT("Space3DGeometry"));
+#endif
+#if !UE_BUILD_SHIPPING
+  if(IsCooking()) WriteCooked(Key, Blob);
+#endif
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+class UStaticMesh;
+
+/**
+The final acoustic geometry of one mesh, every level of detail, as it is sent to Space3D: welded positions, triangle indices and (for unsimplified meshes) normals.
+
+The levels are views into storage the object owns: either the arrays it was built from, or a cache blob, which may be a memory-mapped file. A loaded mesh is thus passed to MeshAdd / MeshSetVertices straight from the file, without being copied or converted.
+*/
+class FSpace3DUnrealCookedGeometry
+{
+public:
+  struct FLOD
+  {
+    const FVector* Vertices;
+    /** nullptr if there are none. */
+    const FVector* Normals;
+    const int32* Indices;
+    int32 NumVertices, NumIndices;
+  };
+
+  FSpace3DUnrealCookedGeometry();
+  ~FSpace3DUnrealCookedGeometry();
+
+  /** Finest first. */
+  TArray<FLOD> LODs;
+
+  /** Adds a level, taking over its arrays. Normals may be empty. */
+  void AddLOD(TArray<FVector>&& Vertices, TArray<FVector>&& Normals, TArray<int32>&& Indices);
+
+  /** The cache blob for this geometry. */
+  void Serialize(TArray<uint8>& OutBlob) const;
+  /** Views into a cache blob of Size bytes at Data, which must stay valid as long as the geometry. Returns false if the blob is not valid. */
+  bool Parse(const uint8* Data, int64 Size);
+
+private:
+  friend class FSpace3DUnrealGeometryCache;
+
+  TArray<TArray<FVector>> OwnedVectors;
+  TArray<TArray<int32>> OwnedIndices;
+  /** Blob read into memory, or a mapped file. Region is destroyed before Handle. */
+  TArray<uint8> OwnedBlob;
+  TUniquePtr<IMappedFileHandle> MappedHandle;
+  TUniquePtr<IMappedFileRegion> MappedRegion;
+};
+
+/**
+Cache of cooked acoustic geometry, so that static meshes are not extracted from their collision data and simplified again every session.
+
+Entries are keyed by the mesh's collision GUID (which changes whenever its collision does), the proxy settings and the blob format version. In the editor, meshes are cached in the derived data cache. The cooked entries shipped with the game live as loose files in Content/Space3D/Geometry, staged as non-UFS files so that they can be memory-mapped. They are written before packaging by USpace3DUnrealCookGeometryCommandlet, for every static mesh a USpace3DUnrealMesh in the project's maps is attached to; running a development build with -Space3DCookGeometry also writes every mesh it loads there. Cooked files are looked up first, in every build.
+
+Any thread.
+*/
+class FSpace3DUnrealGeometryCache
+{
+public:
+  /** Key for Mesh with the given proxy settings, or empty if it has no collision GUID to key it by. Game thread. */
+  static FString MakeKey(const UStaticMesh& Mesh, int32 ProxyTriangles, int32 NumLODs, float FeatureAngle);
+  /** Whether Find() will most likely find Key: there is a cooked file for it, or (in the editor) an entry in the derived data cache. Cheap enough for the game thread. */
+  static bool IsCached(const FString& Key);
+  /** The cached geometry for Key, or nullptr. */
+  static TSharedPtr<FSpace3DUnrealCookedGeometry, ESPMode::ThreadSafe> Find(const FString& Key);
+  /** Stores Geometry under Key, where this build stores anything. */
+  static void Store(const FString& Key, const FSpace3DUnrealCookedGeometry& Geometry);
+#if WITH_EDITOR
+  /** Whether there is a cooked file for Key. */
+  static bool IsCooked(const FString& Key);
+  /** Writes the cooked file for Key, to be shipped with the game. Returns false if it could not be written. */
+  static bool Cook(const FString& Key, const FSpace3DUnrealCookedGeometry& Geometry);
+#endif
+};
@@ -0,0 +1,138 @@
+#include "Space3DUnrealGovernor.h"
+#include "Space3DUnreal.h"
+
+#include "Space3D.hpp"
+
+FSpace3DUnrealGovernor::FSpace3DUnrealGovernor()
+  : bConfigChanged(false)
+  , Tier(0)
+  , FramesOver(0)
+  , FramesUnder(0)
+  , Load(0.0f)
+  , StatTier(0)
+  , StatNumTiers(1)
+  , StatLoad(0.0f)
+  , StatLastLoad(0.0f)
+  , StatDeadlineMs(0.0f)
+  , NumOverruns(0)
+  , NumTierChanges(0)
+{
+  FMemory::Memzero(&Config, sizeof(Config));
+  Config.NumTiers = 1;
+  PendingConfig = Config;
+}
+
+void FSpace3DUnrealGovernor::Configure(const FConfig& InConfig)
+{
+  FScopeLock Lock(&ConfigLock);
+  PendingConfig = InConfig;
+  PendingConfig.NumTiers = FMath::Max(PendingConfig.NumTiers, 1);
+  bConfigChanged = true;
+}
+
+void FSpace3DUnrealGovernor::SetCeiling(const FQuality& Ceiling)
+{
+  FScopeLock Lock(&ConfigLock);
+  PendingConfig.Ceiling = Ceiling;
+  bConfigChanged = true;
+}
+
+FSpace3DUnrealGovernor::FQuality FSpace3DUnrealGovernor::GetCeiling()
+{
+  FScopeLock Lock(&ConfigLock);
+  return PendingConfig.Ceiling;
+}
+
+FSpace3DUnrealGovernor::FQuality FSpace3DUnrealGovernor::QualityOf(int32 InTier) const
+{
+  //A ceiling of 0 rays or branches (e.g. UpdateRTRays(0)) would divide by zero below
+  FQuality Hi = Config.Ceiling;
+  Hi.RTRays = FMath::Max(Hi.RTRays, 1);
+  Hi.RTBranches = FMath::Max(Hi.RTBranches, 1);
+  FQuality Lo = Config.Floor;
+  Lo.Order = FMath::Min(Lo.Order, Hi.Order);
+  Lo.RTRays = FMath::Clamp(Lo.RTRays, 1, Hi.RTRays);
+  Lo.RTBranches = FMath::Clamp(Lo.RTBranches, 1, Hi.RTBranches);
+  Lo.DiffNAngles = FMath::Min(Lo.DiffNAngles, Hi.DiffNAngles);
+  float f = Config.NumTiers > 1 ? (float)InTier / (float)(Config.NumTiers - 1) : 0.0f;
+
+  FQuality Q;
+  //Rays and branches scale cost multiplicatively, so step them geometrically; branches must stay a power of 2
+  Q.RTRays = FMath::RoundToInt((float)Hi.RTRays * FMath::Pow((float)Lo.RTRays / (float)Hi.RTRays, f));
+  float Branches = (float)Hi.RTBranches * FMath::Pow((float)Lo.RTBranches / (float)Hi.RTBranches, f);
+  Q.RTBranches = 1 << FMath::Clamp(FMath::RoundToInt(FMath::Log2(Branches)), 0, 30);
+  Q.Order = FMath::RoundToInt(FMath::Lerp((float)Hi.Order, (float)Lo.Order, f));
+  Q.DiffNAngles = FMath::RoundToInt(FMath::Lerp((float)Hi.DiffNAngles, (float)Lo.DiffNAngles, f));
+  return Q;
+}
+
+void FSpace3DUnrealGovernor::Apply()
+{
+  FQuality Q = QualityOf(Tier);
+  SPACE3D_RAII_LOCK_API;
+  Space3D::SpatParams* p = Space3D::GetParams();
+  p->order = Q.Order;
+  p->rt_rays = Q.RTRays;
+  p->rt_branches = Q.RTBranches;
+  p->vdat_nangles = Q.DiffNAngles;
+}
+
+void FSpace3DUnrealGovernor::OnFrameProcessed(double Seconds, double DeadlineSeconds)
+{
+  {
+    FScopeLock Lock(&ConfigLock);
+    if(bConfigChanged)
+    {
+      bool bWasEnabled = Config.bEnabled;
+      Config = PendingConfig;
+      bConfigChanged = false;
+      Tier = FMath::Min(Tier, Config.NumTiers - 1);
+      FramesOver = FramesUnder = 0;
+      if(Config.bEnabled) Apply();
+      else if(bWasEnabled)
+      {
+        //Back to the preset's own values
+        Tier = 0;
+        Apply();
+      }
+      StatTier.store(Tier, std::memory_order_relaxed);
+      StatNumTiers.store(Config.NumTiers, std::memory_order_relaxed);
+    }
+  }
+
+  float LastLoad = DeadlineSeconds > 0.0 ? (float)(Seconds / DeadlineSeconds) : 0.0f;
+  Load = FMath::Lerp(Load, LastLoad, 0.1f);
+  if(LastLoad > 1.0f) NumOverruns.fetch_add(1, std::memory_order_relaxed);
+  StatLoad.store(Load, std::memory_order_relaxed);
+  StatLastLoad.store(LastLoad, std::memory_order_relaxed);
+  StatDeadlineMs.store((float)(DeadlineSeconds * 1000.0), std::memory_order_relaxed);
+  if(!Config.bEnabled) return;
+
+  //Step down on sustained load measured frame by frame, so a busy scene is caught quickly; step up only on sustained smoothed headroom
+  FramesOver = LastLoad > Config.DownLoad ? FramesOver + 1 : 0;
+  FramesUnder = Load < Config.UpLoad ? FramesUnder + 1 : 0;
+  int32 NewTier = Tier;
+  if(FramesOver >= Config.DownFrames && Tier < Config.NumTiers - 1) NewTier = Tier + 1;
+  else if(FramesUnder >= Config.UpFrames && Tier > 0) NewTier = Tier - 1;
+  if(NewTier == Tier) return;
+
+  Tier = NewTier;
+  FramesOver = FramesUnder = 0;
+  Apply();
+  NumTierChanges.fetch_add(1, std::memory_order_relaxed);
+  StatTier.store(Tier, std::memory_order_relaxed);
+  UE_LOG(LogSpace3DUnreal, Log, TEXT("Space3D quality tier %d of %d, load %.0f%%"), Tier, Config.NumTiers, Load * 100.0f);
+}
+
+FSpace3DUnrealGovernor::FStats FSpace3DUnrealGovernor::GetStats() const
+{
+  FStats Stats;
+  Stats.Tier = StatTier.load(std::memory_order_relaxed);
+  Stats.NumTiers = StatNumTiers.load(std::memory_order_relaxed);
+  Stats.Load = StatLoad.load(std::memory_order_relaxed);
+  Stats.LastLoad = StatLastLoad.load(std::memory_order_relaxed);
+  Stats.DeadlineMs = StatDeadlineMs.load(std::memory_order_relaxed);
+  Stats.Overruns = NumOverruns.load(std::memory_order_relaxed);
+  Stats.TierChanges = NumTierChanges.load(std::memory_order_relaxed);
+  return Stats;
+}
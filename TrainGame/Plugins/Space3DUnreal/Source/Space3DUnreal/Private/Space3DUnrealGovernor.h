@@ -0,0 +1,69 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+
+#include <atomic>
+
+/**
+Closed-loop quality control for Space3D. Every Space3D::Process call is timed against the frame deadline (frame length / sample rate). When processing takes too large a share of the deadline for several frames in a row, the governor steps down a ladder of quality tiers, each with fewer rays, branches, reflection orders and diffraction angles; when there has been plenty of headroom for a long while, it steps back up. Tier 0 is the ceiling (the output preset's values) and the last tier is the floor.
+
+Configure() may be called from any thread; OnFrameProcessed() only by whoever runs Space3D::Process.
+*/
+class FSpace3DUnrealGovernor
+{
+public:
+  struct FQuality
+  {
+    int32 Order, RTRays, RTBranches, DiffNAngles;
+  };
+
+  struct FConfig
+  {
+    bool bEnabled;
+    FQuality Ceiling, Floor;
+    int32 NumTiers;
+    /** Share of the deadline above which to step down, and below which to step up. */
+    float DownLoad, UpLoad;
+    /** Consecutive frames beyond the thresholds before stepping down or up. */
+    int32 DownFrames, UpFrames;
+  };
+
+  struct FStats
+  {
+    int32 Tier, NumTiers;
+    /** Smoothed and last Process time as a share of the deadline. */
+    float Load, LastLoad;
+    float DeadlineMs;
+    uint32 Overruns, TierChanges;
+  };
+
+  FSpace3DUnrealGovernor();
+
+  void Configure(const FConfig& InConfig);
+  /** Sets just the ceiling, e.g. from the UpdateParams Blueprint nodes. */
+  void SetCeiling(const FQuality& Ceiling);
+  FQuality GetCeiling();
+
+  /** Records a Process call which took Seconds against a deadline of DeadlineSeconds, and moves to another tier if called for. */
+  void OnFrameProcessed(double Seconds, double DeadlineSeconds);
+
+  /** Any thread. */
+  FStats GetStats() const;
+
+private:
+  /** Parameters for the given tier, interpolating from ceiling to floor. */
+  FQuality QualityOf(int32 Tier) const;
+  void Apply();
+
+  FCriticalSection ConfigLock;
+  FConfig Config, PendingConfig;
+  bool bConfigChanged;
+
+  int32 Tier, FramesOver, FramesUnder;
+  float Load;
+
+  std::atomic<int32> StatTier, StatNumTiers;
+  std::atomic<float> StatLoad, StatLastLoad, StatDeadlineMs;
+  std::atomic<uint32> NumOverruns, NumTierChanges;
+};
@@ -0,0 +1,151 @@
+#include "Space3DUnrealHMDTracker.h"
+#include "Space3DUnreal.h"
+#include "Camera/CameraComponent.h"
+#include "Engine/Engine.h"
+#include "IXRTrackingSystem.h"
+
+#include "Space3D.hpp"
+
+namespace
+{
+  /** Never extrapolate further than this; beyond it the prediction does more harm than good. */
+  constexpr double MaxPredictionSeconds = 0.05;
+  /** A pose older than this means the HMD has stopped being tracked; the head is left where it is. */
+  constexpr double MaxPoseAge = 0.25;
+  /** Samples closer together than this are too noisy for a velocity estimate, and further apart too stale. */
+  constexpr double MinVelocityInterval = 0.002;
+  constexpr double MaxVelocityInterval = 0.1;
+  /** Weight of each new velocity measurement in the estimate. */
+  constexpr float VelocitySmoothing = 0.5f;
+}
+
+FSpace3DUnrealHMDTracker::FSpace3DUnrealHMDTracker()
+  : Head(0)
+  , PredictionSeconds(0.0f)
+  , bHaveLast(false)
+{}
+
+void FSpace3DUnrealHMDTracker::SetHead(uint64_t uuid, float PredictionMs)
+{
+  PredictionSeconds.store(PredictionMs * 0.001f, std::memory_order_relaxed);
+  uint64_t Old = Head.exchange(uuid);
+  if((Old != 0) == (uuid != 0)) return;
+  if(uuid != 0)
+  {
+    ViewExtension = FSceneViewExtensions::NewExtension<FViewExtension>(this);
+    UE_LOG(LogSpace3DUnreal, Log, TEXT("Head pose late-latched from the HMD on the audio thread"));
+  }
+  else
+  {
+    ViewExtension.Reset();
+    FScopeLock Lock(&PublishLock);
+    bHaveLast = false;
+  }
+}
+
+bool FSpace3DUnrealHMDTracker::GetHMDPose(FVector& Position, FQuat& Rotation)
+{
+  if(GEngine == nullptr || !GEngine->XRSystem.IsValid()) return false;
+  IXRTrackingSystem* XR = GEngine->XRSystem.Get();
+  if(!XR->IsTracking(IXRTrackingSystem::HMDDeviceId)) return false;
+  return XR->GetCurrentPose(IXRTrackingSystem::HMDDeviceId, Rotation, Position);
+}
+
+bool FSpace3DUnrealHMDTracker::UpdateMapping(const USceneComponent* HeadComponent)
+{
+  FVector Position;
+  FQuat Rotation;
+  if(!GetHMDPose(Position, Rotation)) return false;
+  Publish(Position, Rotation, FPlatformTime::Seconds());
+
+  const UCameraComponent* Camera = nullptr;
+  for(const USceneComponent* C = HeadComponent; C != nullptr && Camera == nullptr; C = C->GetAttachParent())
+  {
+    const UCameraComponent* Cam = Cast<UCameraComponent>(C);
+    if(Cam != nullptr && Cam->bLockToHmd) Camera = Cam;
+  }
+  FMapping M;
+  if(Camera != nullptr)
+  {
+    //The camera's relative transform is the HMD pose, so its parent is tracking space
+    const USceneComponent* Origin = Camera->GetAttachParent();
+    M.HeadOffset = HeadComponent->GetComponentTransform().GetRelativeTransform(Camera->GetComponentTransform());
+    M.TrackingToWorld = Origin != nullptr ? Origin->GetSocketTransform(Camera->GetAttachSocketName()) : FTransform::Identity;
+  }
+  else
+  {
+    //No HMD-locked camera; assume the component is where the HMD is right now
+    M.HeadOffset = FTransform::Identity;
+    M.TrackingToWorld = FTransform(Rotation, Position).Inverse() * HeadComponent->GetComponentTransform();
+  }
+  Mapping.Write(M);
+  return true;
+}
+
+void FSpace3DUnrealHMDTracker::SamplePose()
+{
+  FVector Position;
+  FQuat Rotation;
+  if(GetHMDPose(Position, Rotation)) Publish(Position, Rotation, FPlatformTime::Seconds());
+}
+
+void FSpace3DUnrealHMDTracker::Publish(const FVector& Position, const FQuat& Rotation, double Time)
+{
+  FScopeLock Lock(&PublishLock);
+  FPose New;
+  New.Position = Position;
+  New.Rotation = Rotation;
+  New.Velocity = FVector::ZeroVector;
+  New.AngularVelocity = FVector::ZeroVector;
+  New.Time = Time;
+  double dt = bHaveLast ? Time - Last.Time : MaxVelocityInterval + 1.0;
+  if(dt < MinVelocityInterval)
+  {
+    //Too close to the last measured sample; keep its estimate, and measure against it next time
+    New.Velocity = Last.Velocity;
+    New.AngularVelocity = Last.AngularVelocity;
+    Pose.Write(New);
+    return;
+  }
+  if(dt <= MaxVelocityInterval)
+  {
+    FQuat Delta = Rotation * Last.Rotation.Inverse();
+    Delta.EnforceShortestArcWith(FQuat::Identity);
+    FVector Axis;
+    float Angle;
+    Delta.ToAxisAndAngle(Axis, Angle);
+    New.Velocity = FMath::Lerp(Last.Velocity, (Position - Last.Position) / (float)dt, VelocitySmoothing);
+    New.AngularVelocity = FMath::Lerp(Last.AngularVelocity, Axis * (Angle / (float)dt), VelocitySmoothing);
+  }
+  Pose.Write(New);
+  Last = New;
+  bHaveLast = true;
+}
+
+void FSpace3DUnrealHMDTracker::ApplyToHead(uint64_t T)
+{
+  uint64_t uuid = Head.load(std::memory_order_relaxed);
+  if(uuid == 0) return;
+  FPose P;
+  FMapping M;
+  if(!Pose.Read(P) || !Mapping.Read(M)) return;
+  double Age = FPlatformTime::Seconds() - P.Time;
+  if(Age > MaxPoseAge) return;
+
+  float dt = (float)FMath::Clamp(Age + (double)PredictionSeconds.load(std::memory_order_relaxed), 0.0, MaxPredictionSeconds);
+  FVector Position = P.Position + P.Velocity * dt;
+  FQuat Rotation = P.Rotation;
+  float Speed = P.AngularVelocity.Size();
+  if(Speed > KINDA_SMALL_NUMBER) Rotation = FQuat(P.AngularVelocity / Speed, Speed * dt) * Rotation;
+
+  FTransform World = M.HeadOffset * FTransform(Rotation, Position) * M.TrackingToWorld;
+  FVector Location = World.GetLocation();
+  FQuat WorldRotation = World.GetRotation();
+  FVector Scale3D = World.GetScale3D();
+  Space3D::PhysReset(uuid, T, Space3DUnreal::GetScaleFactor() * U2GV(Location), U2GQ(WorldRotation), U2GV(Scale3D));
+}
+
+void FSpace3DUnrealHMDTracker::FViewExtension::PreRenderViewFamily_RenderThread(FRHICommandListImmediate& RHICmdList, FSceneViewFamily& InViewFamily)
+{
+  Tracker->SamplePose();
+}
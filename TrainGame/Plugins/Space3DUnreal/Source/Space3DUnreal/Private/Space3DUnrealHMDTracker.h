@@ -0,0 +1,112 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include "SceneViewExtension.h"
+
+#include <atomic>
+
+/**
+Drives a head sink straight from the HMD pose on the audio thread, instead of from its component's transform as of the last game frame.
+
+The XR system's pose is sampled whenever a fresher one is available--once per game frame, and again on the render thread just before rendering, after the XR system's late update--and published to a lock-free snapshot. From Space3D's physics callback, just before each Process, the latest snapshot is extrapolated a short way ahead with the measured head velocity and the head is PhysReset to it. The game thread also publishes the mapping from tracking space to the world (pawn movement, VR origin, etc.) and the head's offset from the HMD, taken from the camera the head is attached to.
+
+Only one head can be driven, since there is only one HMD.
+*/
+class FSpace3DUnrealHMDTracker
+{
+public:
+  FSpace3DUnrealHMDTracker();
+
+  /** Game thread. Starts driving the head with this uuid (0 = stop), extrapolating the pose PredictionMs ahead of the latest sample, plus the age of that sample. */
+  void SetHead(uint64_t uuid, float PredictionMs);
+  uint64_t GetHead() const { return Head.load(std::memory_order_relaxed); }
+
+  /** Game thread, once per frame: samples the HMD, and publishes where HeadComponent sits relative to it and where tracking space is in the world. If HeadComponent is attached to an HMD-locked camera, these come from the camera's parent; otherwise from HeadComponent's current transform. Returns false if there is no HMD being tracked. */
+  bool UpdateMapping(const USceneComponent* HeadComponent);
+  /** Game or render thread: samples the HMD and publishes the pose. */
+  void SamplePose();
+
+  /** Audio thread, from the Space3D physics callback: PhysResets the head at T to the predicted pose. */
+  void ApplyToHead(uint64_t T);
+
+private:
+  struct FMapping
+  {
+    /** World = HeadOffset * HMD pose * TrackingToWorld. */
+    FTransform HeadOffset, TrackingToWorld;
+  };
+
+  struct FPose
+  {
+    FVector Position;
+    FQuat Rotation;
+    /** Units per second, and rotation axis times radians per second. */
+    FVector Velocity, AngularVelocity;
+    /** FPlatformTime::Seconds() when sampled. */
+    double Time;
+  };
+
+  /** Single value with lock-free reads; writers are serialized. */
+  template<typename T>
+  class TSnapshot
+  {
+  public:
+    TSnapshot() : Seq(0) {}
+    void Write(const T& InValue)
+    {
+      uint32 s = Seq.load(std::memory_order_relaxed);
+      Seq.store(s + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      Value = InValue;
+      Seq.store(s + 2, std::memory_order_release);
+    }
+    /** False if there is nothing published yet, or a writer kept interfering. */
+    bool Read(T& Out) const
+    {
+      for(int32 i=0; i<4; ++i)
+      {
+        uint32 s = Seq.load(std::memory_order_acquire);
+        if(s == 0) return false;
+        if(s & 1) continue;
+        Out = Value;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if(Seq.load(std::memory_order_relaxed) == s) return true;
+      }
+      return false;
+    }
+  private:
+    std::atomic<uint32> Seq;
+    T Value;
+  };
+
+  /** Samples the XR system; false if there is no HMD. */
+  static bool GetHMDPose(FVector& Position, FQuat& Rotation);
+  void Publish(const FVector& Position, const FQuat& Rotation, double Time);
+
+  /** Samples the pose on the render thread, after the XR system's late update. */
+  class FViewExtension : public FSceneViewExtensionBase
+  {
+  public:
+    FViewExtension(const FAutoRegister& AutoRegister, FSpace3DUnrealHMDTracker* InTracker) : FSceneViewExtensionBase(AutoRegister), Tracker(InTracker) {}
+    virtual void SetupViewFamily(FSceneViewFamily& InViewFamily) override {}
+    virtual void SetupView(FSceneViewFamily& InViewFamily, FSceneView& InView) override {}
+    virtual void BeginRenderViewFamily(FSceneViewFamily& InViewFamily) override {}
+    virtual void PreRenderViewFamily_RenderThread(FRHICommandListImmediate& RHICmdList, FSceneViewFamily& InViewFamily) override;
+    virtual void PreRenderView_RenderThread(FRHICommandListImmediate& RHICmdList, FSceneView& InView) override {}
+  private:
+    FSpace3DUnrealHMDTracker* Tracker;
+  };
+
+  std::atomic<uint64_t> Head;
+  std::atomic<float> PredictionSeconds;
+  TSharedPtr<FViewExtension, ESPMode::ThreadSafe> ViewExtension;
+
+  /** Serializes the game and render threads' writes to Pose, and holds the previous sample for the velocity estimate. */
+  FCriticalSection PublishLock;
+  FPose Last;
+  bool bHaveLast;
+
+  TSnapshot<FPose> Pose;
+  TSnapshot<FMapping> Mapping;
+};
@@ -0,0 +1,145 @@
+#include "Space3DUnrealInputFifo.h"
+
+FSpace3DUnrealInputFifo::FSpace3DUnrealInputFifo() : PushLength(0), Backlog(2)
+{
+  Configure(0, 0, 1, 48000.0f);
+}
+
+void FSpace3DUnrealInputFifo::Configure(int32 InNumSlots, int32 InBufferLength, int32 InFrameLength, float InSampleRate)
+{
+  check(InFrameLength > 0 && InSampleRate > 0.0f);
+  Slots = InNumSlots;
+  BufLength = InBufferLength;
+  Length = InFrameLength;
+  SampleRate = InSampleRate;
+  //Room for the most input the consumer may fall behind by, plus the buffer being pushed and a partial frame
+  int32 MaxSamples = BufLength * (MaxBacklogBuffers + 1) + Length;
+  FramesPerSlot = (MaxSamples + Length - 1) / Length;
+  Capacity = FramesPerSlot * Length;
+  Audio.Empty();
+  Audio.SetNumZeroed(Slots * Capacity);
+  FrameKeys.Empty();
+  FrameKeys.SetNumZeroed(Slots * FramesPerSlot);
+  //Pushes are never much shorter than BufLength, even when resampled
+  Pushes = Capacity / FMath::Max(BufLength / 2, 1) + 2;
+  States.Empty();
+  States.SetNumZeroed(Pushes * Slots);
+  PushStarts.Empty();
+  PushStarts.SetNumZeroed(Pushes);
+  WriteIdx.store(0);
+  ReadIdx.store(0);
+  PushIdx.store(0);
+  AppliedIdx.store(0);
+  Origin.store(0);
+  DroppedBuffers.store(0);
+  SkippedFrames.store(0);
+}
+
+void FSpace3DUnrealInputFifo::SetMaxBacklog(int32 Buffers)
+{
+  Backlog.store(FMath::Clamp(Buffers, 1, MaxBacklogBuffers), std::memory_order_relaxed);
+}
+
+bool FSpace3DUnrealInputFifo::BeginPush(int32 NumSamples)
+{
+  check(NumSamples <= BufLength);
+  PushLength = NumSamples;
+  uint64_t W = WriteIdx.load(std::memory_order_relaxed);
+  uint64_t P = PushIdx.load(std::memory_order_relaxed);
+  if(W + PushLength - ReadIdx.load(std::memory_order_acquire) > (uint64_t)Capacity || P - AppliedIdx.load(std::memory_order_acquire) >= (uint64_t)Pushes)
+  {
+    DroppedBuffers.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
+void FSpace3DUnrealInputFifo::Write(int32 Slot, const FSpace3DUnrealSourceState& State, const float* In)
+{
+  uint64_t W = WriteIdx.load(std::memory_order_relaxed);
+  States[(int32)(PushIdx.load(std::memory_order_relaxed) % Pushes) * Slots + Slot] = State;
+  uint64_t* SlotKeys = FrameKeys.GetData() + Slot * FramesPerSlot;
+  for(uint64_t F = W / Length; F * Length < W + PushLength; ++F)
+  {
+    uint64_t& FrameKey = SlotKeys[F % FramesPerSlot];
+    //A frame started by this push, or holding only silence so far, belongs to this source
+    if(F * Length >= W || FrameKey == 0) FrameKey = State.Key;
+    //Never feed one source's audio to another when the slot was reused mid-frame
+    else if(State.Key != 0 && FrameKey != State.Key) FrameKey = MixedFrame;
+  }
+  float* SlotAudio = Audio.GetData() + Slot * Capacity;
+  int32 Start = (int32)(W % Capacity);
+  int32 First = FMath::Min(PushLength, Capacity - Start);
+  if(In != nullptr)
+  {
+    FMemory::Memcpy(SlotAudio + Start, In, First * sizeof(float));
+    FMemory::Memcpy(SlotAudio, In + First, (PushLength - First) * sizeof(float));
+  }
+  else
+  {
+    FMemory::Memzero(SlotAudio + Start, First * sizeof(float));
+    FMemory::Memzero(SlotAudio, (PushLength - First) * sizeof(float));
+  }
+}
+
+void FSpace3DUnrealInputFifo::EndPush(uint64_t T)
+{
+  uint64_t W = WriteIdx.load(std::memory_order_relaxed);
+  uint64_t P = PushIdx.load(std::memory_order_relaxed);
+  PushStarts[(int32)(P % Pushes)] = W;
+  Origin.store(T - SamplesToNs(W), std::memory_order_relaxed);
+  PushIdx.store(P + 1, std::memory_order_release);
+  WriteIdx.store(W + PushLength, std::memory_order_release);
+}
+
+bool FSpace3DUnrealInputFifo::BeginPop(uint64_t& OutSeq, uint64_t& OutT)
+{
+  uint64_t R = ReadIdx.load(std::memory_order_relaxed);
+  uint64_t W = WriteIdx.load(std::memory_order_acquire);
+  //Catch up if the consumer fell behind; the frame queue sees the skipped sequence numbers as dropped frames
+  int32 MaxBuffers = Backlog.load(std::memory_order_relaxed);
+  while(W - R >= (uint64_t)(Length + MaxBuffers * BufLength))
+  {
+    R += Length;
+    SkippedFrames.fetch_add(1, std::memory_order_relaxed);
+  }
+  ReadIdx.store(R, std::memory_order_release);
+  if(W - R < (uint64_t)Length) return false;
+  OutSeq = R / Length;
+  OutT = Origin.load(std::memory_order_relaxed) + SamplesToNs(R);
+  return true;
+}
+
+bool FSpace3DUnrealInputFifo::BeginApply()
+{
+  uint64_t A = AppliedIdx.load(std::memory_order_relaxed);
+  if(A == PushIdx.load(std::memory_order_acquire)) return false;
+  //Pushes skipped while catching up are still applied, so no source is ever left behind
+  return PushStarts[(int32)(A % Pushes)] < ReadIdx.load(std::memory_order_relaxed) + Length;
+}
+
+const FSpace3DUnrealSourceState& FSpace3DUnrealInputFifo::State(int32 Slot) const
+{
+  return States[(int32)(AppliedIdx.load(std::memory_order_relaxed) % Pushes) * Slots + Slot];
+}
+
+void FSpace3DUnrealInputFifo::EndApply()
+{
+  AppliedIdx.store(AppliedIdx.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+uint64_t FSpace3DUnrealInputFifo::Key(int32 Slot) const
+{
+  uint64_t FrameKey = FrameKeys[Slot * FramesPerSlot + (int32)((ReadIdx.load(std::memory_order_relaxed) / Length) % FramesPerSlot)];
+  return FrameKey == MixedFrame ? 0 : FrameKey;
+}
+
+const float* FSpace3DUnrealInputFifo::Frame(int32 Slot) const
+{
+  return Audio.GetData() + Slot * Capacity + (int32)(ReadIdx.load(std::memory_order_relaxed) % Capacity);
+}
+
+void FSpace3DUnrealInputFifo::EndPop()
+{
+  ReadIdx.store(ReadIdx.load(std::memory_order_relaxed) + Length, std::memory_order_release);
+}
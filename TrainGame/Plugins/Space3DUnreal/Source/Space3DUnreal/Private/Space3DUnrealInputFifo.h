@@ -0,0 +1,100 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include <atomic>
+
+/** What Space3D should have for one source slot as of one push to the input FIFO. Applied by whoever runs Space3D, so that the spatializer itself never calls into Space3D. */
+struct FSpace3DUnrealSourceState
+{
+  /** Identifies the Space3D source for as long as it should exist; a different key means a new source. 0 = none. */
+  uint64_t Key;
+  /** Sent with PhysUpdate if bMoved: Space3D time, position with Space3D's scale, rotation. */
+  uint64_t T;
+  FVector Position;
+  FQuat Rotation;
+  bool bMoved;
+  /** The source's properties, applied when it is added, if bHasSettings. */
+  bool bHasSettings;
+  float Volume;
+  int32 DirType;
+  float DirBeamWidth, DirCosMixFactor, DirUnused;
+  float ThresholdFull, ThresholdZero;
+};
+
+/**
+Single-producer, single-consumer FIFO of mono source input, which rebuffers from the engine's buffer size to Space3D's frame length.
+
+Once per engine buffer, the spatializer writes the same number of samples (BufferLength() at most; fewer or varying when the input is resampled) for every source slot (silence for slots which were not processed) and publishes them with EndPush(). All slots share one read and one write position, so they always hold the same span of audio time. Whoever runs Space3D (the spatializer itself, or the render worker) then pops FrameLength() samples at a time for as long as there is a full frame waiting. Frames are always contiguous in memory, so they can be passed straight to Space3D::SourceWrite.
+
+Each push also carries every slot's source state (FSpace3DUnrealSourceState): which source should exist, where it is, and its properties. Before writing a frame to Space3D, the consumer applies the states of every push with audio in that frame or before it (BeginApply()), adding, removing and moving sources, so sources change in step with the audio written to them, and the spatializer never waits for the Space3D API lock.
+
+All storage is allocated in Configure(), never while running.
+*/
+class FSpace3DUnrealInputFifo
+{
+public:
+  FSpace3DUnrealInputFifo();
+
+  /** (Re)allocates the FIFO and resets it. InBufferLength is the most samples pushed at once, and InSampleRate Space3D's sample rate. Must not be called while a producer or consumer is running. */
+  void Configure(int32 InNumSlots, int32 InBufferLength, int32 InFrameLength, float InSampleRate);
+
+  int32 NumSlots() const { return Slots; }
+  int32 BufferLength() const { return BufLength; }
+  int32 FrameLength() const { return Length; }
+
+  /** Consumer: number of engine buffers of input allowed to wait in the FIFO before the oldest frames are skipped. */
+  void SetMaxBacklog(int32 Buffers);
+
+  /** Producer: starts a buffer of NumSamples samples per slot. Returns false if there is no room for it, and it is then dropped. */
+  bool BeginPush(int32 NumSamples);
+  /** Producer: writes this buffer's NumSamples samples and source state for one slot; Audio == nullptr writes silence. The state's key is also kept with each frame the samples land in, so frames already queued keep the source they were written for. */
+  void Write(int32 Slot, const FSpace3DUnrealSourceState& State, const float* Audio);
+  /** Producer: publishes the buffer. T is the Space3D time of its first sample. */
+  void EndPush(uint64_t T);
+
+  /** Producer: whether the consumer has yet to apply the source states of any push. */
+  bool HasUnappliedPushes() const { return PushIdx.load(std::memory_order_relaxed) != AppliedIdx.load(std::memory_order_acquire); }
+
+  /** Consumer: returns false if no full frame is waiting. Otherwise returns the frame's sequence number and the Space3D time of its first sample, and Key()/Frame() refer to it until EndPop(). */
+  bool BeginPop(uint64_t& OutSeq, uint64_t& OutT);
+  /** Consumer, after BeginPop(): returns false once every push with audio in the popped frame (or before it) has been applied. Otherwise State() refers to the oldest push not applied yet until EndApply(). */
+  bool BeginApply();
+  const FSpace3DUnrealSourceState& State(int32 Slot) const;
+  void EndApply();
+  /** Consumer: the key of the source this slot's frame was written for, or 0 if none (or if it holds audio of two different sources). */
+  uint64_t Key(int32 Slot) const;
+  const float* Frame(int32 Slot) const;
+  void EndPop();
+
+  /** Any thread. Number of buffers dropped because the FIFO was full, and of frames skipped to catch up. */
+  uint32 NumDroppedBuffers() const { return DroppedBuffers.load(std::memory_order_relaxed); }
+  uint32 NumSkippedFrames() const { return SkippedFrames.load(std::memory_order_relaxed); }
+
+private:
+  static constexpr int32 MaxBacklogBuffers = 3;
+  /** Frame key marking a frame which one push started for one source and a later push finished for another. */
+  static constexpr uint64_t MixedFrame = ~(uint64_t)0;
+
+  uint64_t SamplesToNs(uint64_t Samples) const { return (uint64_t)((double)Samples * 1000000000.0 / (double)SampleRate); }
+
+  /** Slots x Capacity samples. Capacity is a multiple of the frame length. */
+  TArray<float> Audio;
+  /** Slots x (Capacity / Length) source keys, one per frame. Published along with the audio by WriteIdx. */
+  TArray<uint64_t> FrameKeys;
+  /** Pushes x Slots source states, and the index of each push's first sample, for the last Pushes pushes. */
+  TArray<FSpace3DUnrealSourceState> States;
+  TArray<uint64_t> PushStarts;
+  int32 Slots, BufLength, Length, Capacity, FramesPerSlot, Pushes, PushLength;
+  /** Set by the spatializer every buffer, read by whoever pops. */
+  std::atomic<int32> Backlog;
+  float SampleRate;
+
+  std::atomic<uint64_t> WriteIdx, ReadIdx;
+  /** Number of pushes published, and of those whose source states have been applied. */
+  std::atomic<uint64_t> PushIdx, AppliedIdx;
+  /** Space3D time of sample index 0, so that sample N plays at Origin + SamplesToNs(N). Updated with each push so that jumps in the audio clock are followed. */
+  std::atomic<uint64_t> Origin;
+
+  std::atomic<uint32> DroppedBuffers, SkippedFrames;
+};
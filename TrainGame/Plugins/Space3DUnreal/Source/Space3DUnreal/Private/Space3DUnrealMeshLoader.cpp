@@ -0,0 +1,541 @@
+#include "Space3DUnrealMeshLoader.h"
+#include "Space3DUnreal.h"
+#include "Space3DUnrealCommandBuffer.h"
+#include "Space3DUnrealMeshes.h"
+#include "Space3DUnrealProxyBuilder.h"
+#include "Async/Async.h"
+#include "Engine/StaticMesh.h"
+#include "GameFramework/Actor.h"
+#include "Interfaces/Interface_CollisionDataProvider.h"
+
+#include "Space3D.hpp"
+
+namespace
+{
+  /** Upload budget per game frame until the output preset sets one. */
+  constexpr float DefaultBudgetMs = 2.0f;
+  /** Levels of detail are not simplified below this many triangles (a box). */
+  constexpr int32 MinProxyTriangles = 12;
+  /** A level of detail is only swapped once the listener is this far past the boundary, as a share of ProxyLODDistance. */
+  constexpr float LODHysteresis = 0.1f;
+  /** Cell size until the output preset sets one: no merging. */
+  constexpr float DefaultCellSize = 0.0f;
+  /** A cell is only rebuilt once nothing has been added to it or removed from it for this long, in seconds. */
+  constexpr double CellSettleSeconds = 0.5;
+  /** Stream radius until the output preset sets one: no streaming. */
+  constexpr float DefaultStreamRadius = 0.0f;
+  /** A cell is only streamed out once every listener is this far past the stream radius, as a share of it. */
+  constexpr float StreamHysteresis = 0.25f;
+
+  float DistSquaredToNearest(const FVector& Point, const TArray<FVector>& Listeners)
+  {
+    float Nearest = MAX_flt;
+    for(const FVector& Listener : Listeners) Nearest = FMath::Min(Nearest, FVector::DistSquared(Point, Listener));
+    return Nearest;
+  }
+
+  float DistSquaredToNearest(const FBox& Box, const TArray<FVector>& Listeners)
+  {
+    float Nearest = MAX_flt;
+    for(const FVector& Listener : Listeners) Nearest = FMath::Min(Nearest, Box.ComputeSquaredDistanceToPoint(Listener));
+    return Nearest;
+  }
+}
+
+FSpace3DUnrealMeshLoader::FSpace3DUnrealMeshLoader() : BudgetMs(DefaultBudgetMs), CellSize(DefaultCellSize), StreamRadius(DefaultStreamRadius) {}
+
+void FSpace3DUnrealMeshLoader::Load(USpace3DUnrealMesh* Component, UStaticMesh* Mesh, TArray<FInstance>&& Instances, bool bMerge)
+{
+  check(IsInGameThread());
+  check(Instances.Num() > 0);
+  TUniquePtr<FJob> Job = MakeUnique<FJob>();
+  Job->Component = Component;
+  Job->Instances = MoveTemp(Instances);
+  Job->NumPending = Job->Instances.Num();
+  Job->bMerge = bMerge;
+  Job->bChecked = false;
+  Job->Name = Component->GetOwner() != nullptr ? Component->GetOwner()->GetName() : Component->GetName();
+  int32 ProxyTriangles = Component->ProxyTriangles;
+  int32 NumLODs = FMath::Clamp(Component->ProxyLODs, 1, 3);
+  float FeatureAngle = Component->ProxyFeatureAngle;
+  FString Key = FSpace3DUnrealGeometryCache::MakeKey(*Mesh, ProxyTriangles, NumLODs, FeatureAngle);
+  if(!Key.IsEmpty())
+  {
+    //Already extracted for another component, or on its way
+    FGeometryPtr Geometry;
+    if(const TWeakPtr<FSpace3DUnrealCookedGeometry, ESPMode::ThreadSafe>* Weak = Shared.Find(Key)) Geometry = Weak->Pin();
+    if(Geometry.IsValid())
+    {
+      TPromise<FGeometryPtr> Promise;
+      Promise.SetValue(MoveTemp(Geometry));
+      Job->Task = Promise.GetFuture().Share();
+      Jobs.Add(MoveTemp(Job));
+      return;
+    }
+    if(const TSharedFuture<FGeometryPtr>* Task = Pending.Find(Key))
+    {
+      Job->Task = *Task;
+      Jobs.Add(MoveTemp(Job));
+      return;
+    }
+  }
+  //Collision data is read from the mesh here, on the game thread; the task only converts, simplifies and caches it
+  FTriMeshCollisionData ColData;
+  if(!FSpace3DUnrealGeometryCache::IsCached(Key) && !Mesh->GetPhysicsTriMeshData(&ColData, true))
+  {
+    ColData = FTriMeshCollisionData();
+  }
+  Job->Task = Async(EAsyncExecution::ThreadPool, [ColData = MoveTemp(ColData), Key, ProxyTriangles, NumLODs, FeatureAngle]() mutable -> FGeometryPtr
+  {
+    FGeometryPtr Geometry = FSpace3DUnrealGeometryCache::Find(Key);
+    if(Geometry.IsValid()) return Geometry;
+    Geometry = Extract(MoveTemp(ColData), ProxyTriangles, NumLODs, FeatureAngle);
+    if(Geometry.IsValid()) FSpace3DUnrealGeometryCache::Store(Key, *Geometry);
+    return Geometry;
+  }).Share();
+  if(!Key.IsEmpty()) Pending.Add(Key, Job->Task);
+  Jobs.Add(MoveTemp(Job));
+}
+
+#if WITH_EDITOR
+bool FSpace3DUnrealMeshLoader::Cook(const USpace3DUnrealMesh& Component, UStaticMesh& Mesh)
+{
+  check(IsInGameThread());
+  //The same settings, and so the same key, as Load
+  int32 ProxyTriangles = Component.ProxyTriangles;
+  int32 NumLODs = FMath::Clamp(Component.ProxyLODs, 1, 3);
+  float FeatureAngle = Component.ProxyFeatureAngle;
+  FString Key = FSpace3DUnrealGeometryCache::MakeKey(Mesh, ProxyTriangles, NumLODs, FeatureAngle);
+  if(Key.IsEmpty()) return false;
+  if(FSpace3DUnrealGeometryCache::IsCooked(Key)) return true;
+  FGeometryPtr Geometry = FSpace3DUnrealGeometryCache::Find(Key);
+  if(!Geometry.IsValid())
+  {
+    FTriMeshCollisionData ColData;
+    if(!Mesh.GetPhysicsTriMeshData(&ColData, true)) return false;
+    Geometry = Extract(MoveTemp(ColData), ProxyTriangles, NumLODs, FeatureAngle);
+    if(!Geometry.IsValid()) return false;
+    FSpace3DUnrealGeometryCache::Store(Key, *Geometry);
+  }
+  return FSpace3DUnrealGeometryCache::Cook(Key, *Geometry);
+}
+#endif
+
+FSpace3DUnrealMeshLoader::FGeometryPtr FSpace3DUnrealMeshLoader::Extract(FTriMeshCollisionData&& ColData, int32 ProxyTriangles, int32 NumLODs, float FeatureAngle)
+{
+  if(ColData.Vertices.Num() == 0 || ColData.Indices.Num() == 0) return nullptr;
+  //"Indices" is actually triangles
+  static_assert(sizeof(FTriIndices) == 3 * sizeof(int32), "FTriIndices must be three packed indices");
+  TArray<int32> Indices;
+  Indices.SetNumUninitialized(ColData.Indices.Num() * 3);
+  FMemory::Memcpy(Indices.GetData(), ColData.Indices.GetData(), ColData.Indices.Num() * sizeof(FTriIndices));
+  FGeometryPtr Geometry = MakeShared<FSpace3DUnrealCookedGeometry, ESPMode::ThreadSafe>();
+  BuildLODs(*Geometry, MoveTemp(ColData.Vertices), MoveTemp(ColData.Normals), MoveTemp(Indices), ProxyTriangles, NumLODs, FeatureAngle);
+  return Geometry;
+}
+
+void FSpace3DUnrealMeshLoader::BuildLODs(FSpace3DUnrealCookedGeometry& Geometry, TArray<FVector>&& Vertices, TArray<FVector>&& Normals, TArray<int32>&& Indices, int32 ProxyTriangles, int32 NumLODs, float FeatureAngle)
+{
+  if(ProxyTriangles <= 0)
+  {
+    Geometry.AddLOD(MoveTemp(Vertices), MoveTemp(Normals), MoveTemp(Indices));
+    return;
+  }
+  FSpace3DUnrealProxyBuilder Builder(Vertices.GetData(), Vertices.Num(), Indices.GetData(), Indices.Num(), FeatureAngle);
+  int32 Target = ProxyTriangles;
+  for(int32 l=0; l<NumLODs; ++l, Target /= 4)
+  {
+    if(l == 0 && Indices.Num() / 3 <= Target)
+    {
+      //Already within budget; keep it as it is, normals and all
+      Geometry.AddLOD(MoveTemp(Vertices), MoveTemp(Normals), MoveTemp(Indices));
+      continue;
+    }
+    int32 Before = Builder.GetNumTriangles();
+    Builder.Simplify(FMath::Max(Target, MinProxyTriangles));
+    if(l > 0 && Builder.GetNumTriangles() >= Before) break; //Can't get any coarser
+    TArray<FVector> LODVertices;
+    TArray<int32> LODIndices;
+    Builder.GetMesh(LODVertices, LODIndices);
+    if(LODIndices.Num() == 0) break;
+    Geometry.AddLOD(MoveTemp(LODVertices), TArray<FVector>(), MoveTemp(LODIndices));
+  }
+  if(Geometry.LODs.Num() == 0) Geometry.AddLOD(MoveTemp(Vertices), MoveTemp(Normals), MoveTemp(Indices));
+}
+
+int32 FSpace3DUnrealMeshLoader::ChooseLOD(const USpace3DUnrealMesh& Component, float DistSquared, int32 NumLODs, int32 Current)
+{
+  float Step = Component.ProxyLODDistance;
+  if(NumLODs <= 1 || Step <= 0.0f) return 0;
+  float Distance = FMath::Sqrt(DistSquared);
+  int32 LOD = FMath::Min((int32)(Distance / Step), NumLODs - 1);
+  if(Current == INDEX_NONE || LOD == Current) return LOD;
+  //Only once clearly across the boundary, so that a listener standing on it doesn't swap back and forth
+  float Boundary = (LOD > Current ? Current + 1 : Current) * Step;
+  return FMath::Abs(Distance - Boundary) > LODHysteresis * Step ? LOD : Current;
+}
+
+void FSpace3DUnrealMeshLoader::Tick(const TArray<FVector>& Listeners, uint64_t T)
+{
+  check(IsInGameThread());
+  //Finished geometry is shared for as long as anything holds it
+  for(auto It = Pending.CreateIterator(); It; ++It)
+  {
+    if(!It.Value().IsReady()) continue;
+    const FGeometryPtr& Geometry = It.Value().Get();
+    if(Geometry.IsValid()) Shared.Add(It.Key(), Geometry);
+    It.RemoveCurrent();
+  }
+  for(auto It = Shared.CreateIterator(); It; ++It)
+  {
+    if(!It.Value().IsValid()) It.RemoveCurrent();
+  }
+
+  //Drop what can't be uploaded, merge what goes into cells, and queue the rest of the finished jobs' instances
+  Ready.Reset();
+  for(int32 i=Jobs.Num()-1; i>=0; --i)
+  {
+    FJob& Job = *Jobs[i];
+    Job.bChecked = false;
+    if(!Job.Task.IsReady()) continue;
+    if(!Job.Component.IsValid())
+    {
+      Jobs.RemoveAtSwap(i);
+    }
+    else if(!Job.Task.Get().IsValid())
+    {
+      UE_LOG(LogSpace3DUnreal, Error, TEXT("%s: Could not get collision tri mesh from CollisionDataProvider"), *Job.Name);
+      Jobs.RemoveAtSwap(i);
+    }
+    else if(Job.bMerge)
+    {
+      Merge(Job);
+      Jobs.RemoveAtSwap(i);
+    }
+    else
+    {
+      Job.bChecked = true;
+    }
+  }
+  for(int32 i=0; i<Jobs.Num(); ++i)
+  {
+    FJob& Job = *Jobs[i];
+    if(!Job.bChecked) continue;
+    const FTransform& ComponentTransform = Job.Component->GetComponentTransform();
+    int32 NumLODs = Job.Task.Get()->LODs.Num();
+    for(int32 n=0; n<Job.Instances.Num(); ++n)
+    {
+      const FInstance& Instance = Job.Instances[n];
+      if(!Instance.OnCreated) continue;
+      float DistSquared = DistSquaredToNearest(ComponentTransform.TransformPosition(Instance.Transform.GetLocation()), Listeners);
+      Ready.Add(FUpload{DistSquared, i, n, ChooseLOD(*Job.Component, DistSquared, NumLODs, INDEX_NONE), FUpload::EKind::Upload, FIntVector::ZeroValue});
+    }
+  }
+
+  //Uploaded meshes whose component has gone, or has created another object (or fewer instances), were removed with it
+  Residents.RemoveAll([](const FResident& R)
+  {
+    const USpace3DUnrealMesh* Component = R.Component.Get();
+    return Component == nullptr || Component->GetInstanceUuid(R.InstanceIndex) != R.uuid;
+  });
+  for(int32 i=0; i<Residents.Num(); ++i)
+  {
+    const FResident& R = Residents[i];
+    const USpace3DUnrealMesh* Component = R.Component.Get();
+    //Referenced by uuid on the audio side; keeps the level it has. Instances are only ever placed from here.
+    if(!Component->bInstanced && (Component->MotionPrediction != ESpace3DUnrealPrediction::None || Component->IsPosedExternally())) continue;
+    float DistSquared = DistSquaredToNearest(Component->GetComponentTransform().TransformPosition(R.Instance.Transform.GetLocation()), Listeners);
+    int32 LOD = ChooseLOD(*Component, DistSquared, R.Geometry->LODs.Num(), R.LOD);
+    if(LOD != R.LOD) Ready.Add(FUpload{DistSquared, i, R.InstanceIndex, LOD, FUpload::EKind::Swap, FIntVector::ZeroValue});
+  }
+
+  //Cells near a listener are baked once they have settled, and uploaded when baked; the rest are streamed out
+  double Now = FPlatformTime::Seconds();
+  float Radius = StreamRadius.load(std::memory_order_relaxed);
+  for(auto It = Cells.CreateIterator(); It; ++It)
+  {
+    FCell& Cell = It.Value();
+    float DistSquared = DistSquaredToNearest(Cell.Bounds, Listeners);
+    bool bWanted = Radius <= 0.0f || DistSquared < FMath::Square(Radius)
+      || (Cell.uuid != 0 && DistSquared < FMath::Square(Radius * (1.0f + StreamHysteresis)));
+    if(!bWanted)
+    {
+      Cell.Bake = TFuture<FCellMeshPtr>();
+      if(Cell.uuid != 0) Ready.Add(FUpload{DistSquared, INDEX_NONE, 0, 0, FUpload::EKind::StreamOut, It.Key()});
+      continue;
+    }
+    if(Cell.Bake.IsValid())
+    {
+      if(Cell.Bake.IsReady()) Ready.Add(FUpload{DistSquared, INDEX_NONE, 0, 0, FUpload::EKind::Cell, It.Key()});
+      continue;
+    }
+    bool bDue = Cell.bDirty ? Now - Cell.ChangedAt >= CellSettleSeconds : Cell.uuid == 0;
+    if(bDue && !StartBake(Cell))
+    {
+      if(Cell.uuid != 0) Space3DUnreal::GetCommands().Remove(FSpace3DUnrealCommandBuffer::EObject::Mesh, Cell.uuid);
+      It.RemoveCurrent();
+    }
+  }
+  if(Ready.Num() == 0) return;
+  Ready.Sort([](const FUpload& A, const FUpload& B) { return A.DistSquared < B.DistSquared; });
+
+  double Deadline = FPlatformTime::Seconds() + BudgetMs.load(std::memory_order_relaxed) * 0.001;
+  int32 NumUploaded = 0;
+  for(const FUpload& U : Ready)
+  {
+    if(NumUploaded > 0 && FPlatformTime::Seconds() >= Deadline) break;
+    ++NumUploaded;
+    if(U.Kind == FUpload::EKind::Swap)
+    {
+      FResident& R = Residents[U.Index];
+      R.uuid = Upload(R.Geometry->LODs[U.LOD], *R.Component, R.Instance, T, R.uuid);
+      R.LOD = U.LOD;
+      continue;
+    }
+    if(U.Kind == FUpload::EKind::Cell)
+    {
+      if(!UploadCell(Cells[U.Cell], T)) Cells.Remove(U.Cell);
+      continue;
+    }
+    if(U.Kind == FUpload::EKind::StreamOut)
+    {
+      FCell& Cell = Cells[U.Cell];
+      {
+        SPACE3D_RAII_LOCK_API;
+        Space3D::MeshRemove(Cell.uuid);
+      }
+      Cell.uuid = 0;
+      UE_LOG(LogSpace3DUnreal, Verbose, TEXT("Streamed out cell of %d static meshes"), Cell.Members.Num());
+      continue;
+    }
+    FJob& Job = *Jobs[U.Index];
+    FInstance& Instance = Job.Instances[U.Instance];
+    const FGeometryPtr& Geometry = Job.Task.Get();
+    const FSpace3DUnrealCookedGeometry::FLOD& LOD = Geometry->LODs[U.LOD];
+    FString Name = Job.Instances.Num() > 1 ? FString::Printf(TEXT("%s[%d]"), *Job.Name, U.Instance) : Job.Name;
+    if(LOD.Normals == nullptr && Job.Component->ProxyTriangles <= 0 && U.Instance == 0)
+    {
+      UE_LOG(LogSpace3DUnreal, Warning, TEXT("%s: Static mesh does not have normals"), *Job.Name);
+    }
+    uint64_t NewUuid = Upload(LOD, *Job.Component, Instance, T, 0);
+    if(NewUuid != 0)
+    {
+      UE_LOG(LogSpace3DUnreal, Log, TEXT("%s: Uploaded static mesh, level of detail %d of %d, %d triangles"), *Name, U.LOD, Geometry->LODs.Num(), LOD.NumIndices / 3);
+      if(Geometry->LODs.Num() > 1)
+      {
+        Residents.Add(FResident{Job.Component, MoveTemp(Instance), U.Instance, Geometry, NewUuid, U.LOD, MoveTemp(Name)});
+      }
+    }
+    Instance.OnCreated = nullptr;
+    if(--Job.NumPending == 0) Jobs[U.Index].Reset();
+  }
+  Jobs.RemoveAll([](const TUniquePtr<FJob>& Job) { return !Job.IsValid(); });
+  Residents.RemoveAll([](const FResident& R) { return R.uuid == 0; });
+  UE_LOG(LogSpace3DUnreal, Verbose, TEXT("Uploaded %d static meshes or cells, %d components pending"), NumUploaded, Jobs.Num());
+}
+
+void FSpace3DUnrealMeshLoader::Remove(const USpace3DUnrealMesh* Component)
+{
+  check(IsInGameThread());
+  //Components are also removed on the way out of the world, when they are already pending kill
+  for(const TUniquePtr<FJob>& Job : Jobs)
+  {
+    if(Job->Component.Get(true) == Component) Job->Component.Reset();
+  }
+  for(auto It = Cells.CreateIterator(); It; ++It)
+  {
+    FCell& Cell = It.Value();
+    int32 NumRemoved = Cell.Members.RemoveAll([Component](const FMember& M)
+    {
+      const USpace3DUnrealMesh* MemberComponent = M.Component.Get(true);
+      return MemberComponent == nullptr || MemberComponent == Component;
+    });
+    if(NumRemoved == 0) continue;
+    if(Cell.Members.Num() > 0)
+    {
+      Cell.Bounds = FBox(ForceInit);
+      for(const FMember& M : Cell.Members) Cell.Bounds += M.Bounds;
+      MarkDirty(Cell);
+      continue;
+    }
+    //Last one out; removed along with everything else recorded this frame
+    if(Cell.uuid != 0) Space3DUnreal::GetCommands().Remove(FSpace3DUnrealCommandBuffer::EObject::Mesh, Cell.uuid);
+    It.RemoveCurrent();
+  }
+}
+
+void FSpace3DUnrealMeshLoader::Merge(FJob& Job)
+{
+  const FGeometryPtr& Geometry = Job.Task.Get();
+  const FTransform& ComponentTransform = Job.Component->GetComponentTransform();
+  float Size = FMath::Max(GetCellSize(), 1.0f);
+  const FSpace3DUnrealCookedGeometry::FLOD& LOD = Geometry->LODs[0];
+  FBox LocalBounds(LOD.Vertices, LOD.NumVertices);
+  for(FInstance& Instance : Job.Instances)
+  {
+    FTransform Transform = Instance.Transform * ComponentTransform;
+    FVector Location = Transform.GetLocation();
+    FIntVector Key(FMath::FloorToInt(Location.X / Size), FMath::FloorToInt(Location.Y / Size), FMath::FloorToInt(Location.Z / Size));
+    FCell* Cell = Cells.Find(Key);
+    if(Cell == nullptr)
+    {
+      Cell = &Cells.Add(Key, FCell{TArray<FMember>(), 0, 0.0, false, FBox(ForceInit), TFuture<FCellMeshPtr>()});
+    }
+    FMember& Member = Cell->Members.Add_GetRef(FMember{Job.Component, MoveTemp(Instance.OnCreated), Geometry, Transform, LocalBounds.TransformBy(Transform)});
+    Cell->Bounds += Member.Bounds;
+    MarkDirty(*Cell);
+  }
+  UE_LOG(LogSpace3DUnreal, Log, TEXT("%s: Merged static mesh into cells"), *Job.Name);
+}
+
+void FSpace3DUnrealMeshLoader::MarkDirty(FCell& Cell)
+{
+  Cell.bDirty = true;
+  Cell.ChangedAt = FPlatformTime::Seconds();
+}
+
+bool FSpace3DUnrealMeshLoader::StartBake(FCell& Cell)
+{
+  Cell.bDirty = false;
+  Cell.Members.RemoveAll([](const FMember& M) { return !M.Component.IsValid(); });
+  if(Cell.Members.Num() == 0) return false;
+  TArray<FBakeItem> Items;
+  Items.Reserve(Cell.Members.Num());
+  for(const FMember& M : Cell.Members)
+  {
+    Items.Add(FBakeItem{M.Geometry, M.Transform, (uint8)M.Component->MaterialIndex});
+  }
+  float Scale = Space3DUnreal::GetScaleFactor();
+  Cell.Bake = Async(EAsyncExecution::ThreadPool, [Items = MoveTemp(Items), Scale]() { return BakeCell(Items, Scale); });
+  return true;
+}
+
+FSpace3DUnrealMeshLoader::FCellMeshPtr FSpace3DUnrealMeshLoader::BakeCell(const TArray<FBakeItem>& Items, float Scale)
+{
+  //All in world space, with the scale Space3D uses; materials per vertex
+  FCellMeshPtr Mesh = MakeShared<FCellMesh, ESPMode::ThreadSafe>();
+  int32 NumVertices = 0, NumIndices = 0;
+  for(const FBakeItem& Item : Items)
+  {
+    const FSpace3DUnrealCookedGeometry::FLOD& LOD = Item.Geometry->LODs[0];
+    NumVertices += LOD.NumVertices;
+    NumIndices += LOD.NumIndices;
+  }
+  Mesh->Vertices.Reserve(NumVertices);
+  Mesh->Normals.Reserve(NumVertices);
+  Mesh->Indices.Reserve(NumIndices);
+  Mesh->Materials.Reserve(NumVertices);
+  for(const FBakeItem& Item : Items)
+  {
+    const FSpace3DUnrealCookedGeometry::FLOD& LOD = Item.Geometry->LODs[0];
+    int32 Base = Mesh->Vertices.Num();
+    for(int32 v=0; v<LOD.NumVertices; ++v)
+    {
+      Mesh->Vertices.Add(Item.Transform.TransformPosition(LOD.Vertices[v]) * Scale);
+    }
+    //Members without normals (simplified or cached proxies) get the area-weighted normals of their faces, so the cell keeps them
+    const FVector* Normals = LOD.Normals;
+    TArray<FVector> FaceNormals;
+    if(Normals == nullptr)
+    {
+      FaceNormals.SetNumZeroed(LOD.NumVertices);
+      for(int32 i=0; i<LOD.NumIndices; i+=3)
+      {
+        int32 A = LOD.Indices[i], B = LOD.Indices[i + 1], C = LOD.Indices[i + 2];
+        FVector Face = (LOD.Vertices[C] - LOD.Vertices[A]) ^ (LOD.Vertices[B] - LOD.Vertices[A]);
+        FaceNormals[A] += Face;
+        FaceNormals[B] += Face;
+        FaceNormals[C] += Face;
+      }
+      Normals = FaceNormals.GetData();
+    }
+    //Inverse transpose, for non-uniform scale
+    FVector InvScale = FTransform::GetSafeScaleReciprocal(Item.Transform.GetScale3D());
+    for(int32 v=0; v<LOD.NumVertices; ++v)
+    {
+      Mesh->Normals.Add(Item.Transform.TransformVectorNoScale(Normals[v] * InvScale).GetSafeNormal());
+    }
+    //A mirroring transform turns the triangles inside out
+    bool bMirrored = Item.Transform.GetDeterminant() < 0.0f;
+    for(int32 i=0; i<LOD.NumIndices; i+=3)
+    {
+      Mesh->Indices.Add(Base + LOD.Indices[i]);
+      Mesh->Indices.Add(Base + LOD.Indices[bMirrored ? i + 2 : i + 1]);
+      Mesh->Indices.Add(Base + LOD.Indices[bMirrored ? i + 1 : i + 2]);
+    }
+    int32 FirstMaterial = Mesh->Materials.AddUninitialized(LOD.NumVertices);
+    FMemory::Memset(Mesh->Materials.GetData() + FirstMaterial, Item.Material, LOD.NumVertices);
+  }
+  return Mesh;
+}
+
+bool FSpace3DUnrealMeshLoader::UploadCell(FCell& Cell, uint64_t T)
+{
+  FCellMeshPtr Mesh = Cell.Bake.Get();
+  Cell.Bake = TFuture<FCellMeshPtr>();
+  uint64_t OldUuid = Cell.uuid;
+  Cell.uuid = 0;
+  SPACE3D_RAII_LOCK_API;
+  uint64_t NewUuid = Space3D::MeshAdd(Mesh->Vertices.Num(), Mesh->Indices.Num() / 3, (const uint32_t*)Mesh->Indices.GetData());
+  Space3D::MeshSetVertices(NewUuid, (const glm::vec3*)Mesh->Vertices.GetData(), Mesh->Normals.Num() > 0 ? (const glm::vec3*)Mesh->Normals.GetData() : nullptr, false);
+  Space3D::MeshSetMaterials(NewUuid, Mesh->Materials.GetData());
+  Space3D::PhysReset(NewUuid, T, U2GV(FVector::ZeroVector), U2GQ(FQuat::Identity), U2GV(FVector::OneVector));
+  //With the lock still held, so the old cell is never seen alongside the new one
+  int32 NumMembers = Cell.Members.Num();
+  for(int32 m=Cell.Members.Num()-1; m>=0; --m)
+  {
+    if(!Cell.Members[m].OnCreated(NewUuid)) Cell.Members.RemoveAtSwap(m);
+  }
+  if(Cell.Members.Num() > 0)
+  {
+    Cell.uuid = NewUuid;
+    //Some went away in the meantime; built again without them
+    if(Cell.Members.Num() < NumMembers) MarkDirty(Cell);
+  }
+  else
+  {
+    Space3D::MeshRemove(NewUuid);
+  }
+  if(OldUuid != 0) Space3D::MeshRemove(OldUuid);
+  UE_LOG(LogSpace3DUnreal, Log, TEXT("Uploaded cell of %d static meshes, %d triangles"), Cell.Members.Num(), Mesh->Indices.Num() / 3);
+  return Cell.Members.Num() > 0;
+}
+
+uint64_t FSpace3DUnrealMeshLoader::Upload(const FSpace3DUnrealCookedGeometry::FLOD& LOD, const USpace3DUnrealMesh& Component, const FInstance& Instance, uint64_t T, uint64_t OldUuid)
+{
+  //Meshes are scaled along with positions, see USpace3DUnrealMesh::RequiresScaleScale
+  FTransform Transform = Instance.Transform * Component.GetComponentTransform();
+  float Scale = Space3DUnreal::GetScaleFactor();
+  FVector Position = Transform.GetLocation() * Scale;
+  FQuat Rotation = Transform.GetRotation();
+  FVector Scale3D = Transform.GetScale3D() * Scale;
+  SPACE3D_RAII_LOCK_API;
+  //Every instance is added from the same shared buffers; Space3D keeps its own copy
+  uint64_t NewUuid = Space3D::MeshAdd(LOD.NumVertices, LOD.NumIndices / 3, (const uint32_t*)LOD.Indices);
+  Space3D::MeshSetVertices(NewUuid, (const glm::vec3*)LOD.Vertices, (const glm::vec3*)LOD.Normals, false);
+  Space3D::MeshSetMaterial(NewUuid, (uint8_t)Component.MaterialIndex);
+  Space3D::PhysReset(NewUuid, T, U2GV(Position), U2GQ(Rotation), U2GV(Scale3D));
+  //With the lock still held, so the old level is never seen alongside the new one
+  if(!Instance.OnCreated(NewUuid))
+  {
+    Space3D::MeshRemove(NewUuid);
+    return 0;
+  }
+  if(OldUuid != 0) Space3D::MeshRemove(OldUuid);
+  return NewUuid;
+}
+
+void FSpace3DUnrealMeshLoader::Reset()
+{
+  for(const TUniquePtr<FJob>& Job : Jobs) Job->Task.Wait();
+  Jobs.Empty();
+  Residents.Empty();
+  Ready.Empty();
+  Pending.Empty();
+  Shared.Empty();
+  for(const TPair<FIntVector, FCell>& Pair : Cells)
+  {
+    if(Pair.Value.Bake.IsValid()) Pair.Value.Bake.Wait();
+  }
+  Cells.Empty();
+}
@@ -0,0 +1,180 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+#include "Space3DUnrealGeometryCache.h"
+
+#include <atomic>
+
+class UStaticMesh;
+class USpace3DUnrealMesh;
+struct FTriMeshCollisionData;
+
+/**
+Imports static meshes into Space3D in the background, so that a level full of USpace3DUnrealMesh components does not hitch the game or stall audio processing when it loads.
+
+Each mesh's geometry is loaded from FSpace3DUnrealGeometryCache, or else extracted from its collision data, simplified into acoustic proxies if the component asks for them (FSpace3DUnrealProxyBuilder) and cached, on a thread pool task, all meshes in parallel. The collision data itself (GetPhysicsTriMeshData, which may cook it) is copied out of the mesh on the game thread by Load, unless the cache has the mesh, so the task never touches the asset. The finished meshes are uploaded by Tick, once per game frame, nearest to the listener first, each with its own short API lock for MeshAdd, MeshSetVertices, its material and its initial PhysReset, until the frame's time budget is spent. Audio processing is thus only ever held up for one mesh, and the geometry around the listener is there first.
+
+Meshes with more than one level of detail are kept here after they are uploaded, and swapped for another level when the listener moves across the component's ProxyLODDistance (with some hysteresis), within the same budget. Space3D has no levels of detail of its own, so a swap adds the new level as a new mesh and removes the old one under one API lock, and the component's uuid changes.
+
+Components with the same mesh and proxy settings (the same FSpace3DUnrealGeometryCache key) share one geometry: one task extracts it, and it is kept, refcounted, for as long as any of them still has something to upload or levels of detail to swap. Space3D has no instancing of its own, so each instance is still its own Space3D mesh, added from the shared buffers and placed by its own transform.
+
+Static meshes which never move can instead be merged into cells: one Space3D mesh per cube of the world, in world space, with each mesh's material kept per vertex. A cell is baked on a thread pool task once no mesh has been added to it or removed from it for a moment, so that a level loading in does not rebuild it over and over, and uploaded within the same budget; the new mesh replaces the old one under one API lock. Every component in a cell has the cell's uuid.
+
+Cells are also streamed: only those within the stream radius of a listener are kept in Space3D, so that the geometry the ray tracer sees stays about the same however long the level is. A cell is baked and uploaded again when a listener comes within the radius, and removed when all of them are further than the radius plus some hysteresis, both within the budget. While its cell is streamed out, a component keeps the uuid it had.
+
+A mesh whose component is gone by the time its task is done is dropped without being uploaded.
+*/
+class FSpace3DUnrealMeshLoader
+{
+public:
+  /** One copy of the mesh to upload for a component. */
+  struct FInstance
+  {
+    /** Relative to the component. */
+    FTransform Transform;
+    /** Called with the uuid of each mesh uploaded for this instance, as with FSpace3DUnrealCommandBuffer::Add; if it returns false the mesh is removed again straight away. */
+    TFunction<bool(uint64_t)> OnCreated;
+  };
+
+  FSpace3DUnrealMeshLoader();
+
+  /** Game thread: starts extracting Mesh's collision geometry for Component, reading its proxy settings, unless another component already has, and uploads a copy of it for each of Instances. bMerge: add the instances to their cells instead, using the first level of detail. */
+  void Load(USpace3DUnrealMesh* Component, UStaticMesh* Mesh, TArray<FInstance>&& Instances, bool bMerge);
+  /** Game thread: drops anything still to be loaded for Component, and takes it out of its cells, which are rebuilt without it or removed if it was the last in them. */
+  void Remove(const USpace3DUnrealMesh* Component);
+  /** Game thread: uploads meshes which are ready, swaps levels of detail and streams cells in and out, nearest to any of Listeners first, until the budget is spent (always at least one). T: Space3D time of their initial PhysReset. */
+  void Tick(const TArray<FVector>& Listeners, uint64_t T);
+  /** Game thread: waits for all extraction tasks, and drops everything not uploaded yet. */
+  void Reset();
+  bool IsIdle() const { return Jobs.Num() == 0 && Residents.Num() == 0 && Cells.Num() == 0; }
+
+  /** Milliseconds of uploads per game frame, set from the output preset. Any thread. */
+  void SetBudgetMs(float Ms) { BudgetMs.store(Ms, std::memory_order_relaxed); }
+  /** Size of the cells static meshes are merged into, set from the output preset; 0 = no merging. Any thread. */
+  void SetCellSize(float Size) { CellSize.store(Size, std::memory_order_relaxed); }
+  float GetCellSize() const { return CellSize.load(std::memory_order_relaxed); }
+  /** Distance from the listeners (in Unreal units) within which cells are kept in Space3D, set from the output preset; 0 = all of them. Any thread. */
+  void SetStreamRadius(float Radius) { StreamRadius.store(Radius, std::memory_order_relaxed); }
+
+#if WITH_EDITOR
+  /** Game thread: builds Mesh's geometry with Component's proxy settings, as Load would, and writes its cooked file (FSpace3DUnrealGeometryCache::Cook) unless there already is one. Returns false if it has no geometry or could not be written. */
+  static bool Cook(const USpace3DUnrealMesh& Component, UStaticMesh& Mesh);
+#endif
+
+private:
+  using FGeometryPtr = TSharedPtr<FSpace3DUnrealCookedGeometry, ESPMode::ThreadSafe>;
+
+  struct FJob
+  {
+    TWeakObjectPtr<USpace3DUnrealMesh> Component;
+    /** OnCreated is reset once an instance has been uploaded. */
+    TArray<FInstance> Instances;
+    int32 NumPending;
+    bool bMerge;
+    /** Finished and checked by this Tick, so its instances may be queued. Its task may finish in between, so later steps go by this rather than IsReady(). */
+    bool bChecked;
+    /** Returns the geometry, or nullptr if it could not be extracted. May be shared with other jobs. */
+    TSharedFuture<FGeometryPtr> Task;
+    FString Name;
+  };
+
+  /** An uploaded instance with levels of detail to swap between. */
+  struct FResident
+  {
+    TWeakObjectPtr<USpace3DUnrealMesh> Component;
+    FInstance Instance;
+    int32 InstanceIndex;
+    FGeometryPtr Geometry;
+    uint64_t uuid;
+    int32 LOD;
+    FString Name;
+  };
+
+  /** An instance merged into a cell, placed in world space. */
+  struct FMember
+  {
+    TWeakObjectPtr<USpace3DUnrealMesh> Component;
+    TFunction<bool(uint64_t)> OnCreated;
+    FGeometryPtr Geometry;
+    FTransform Transform;
+    FBox Bounds;
+  };
+
+  /** A cell's mesh, baked in world space, with Space3D's scale. */
+  struct FCellMesh
+  {
+    TArray<FVector> Vertices;
+    /** Members' own normals, or for those without, the normals of their faces. */
+    TArray<FVector> Normals;
+    TArray<int32> Indices;
+    TArray<uint8> Materials;
+  };
+  using FCellMeshPtr = TSharedPtr<FCellMesh, ESPMode::ThreadSafe>;
+
+  struct FCell
+  {
+    TArray<FMember> Members;
+    /** 0 until it is first uploaded, and while it is streamed out. */
+    uint64_t uuid;
+    /** FPlatformTime::Seconds() of the last change. */
+    double ChangedAt;
+    /** Changed since the last bake was started. */
+    bool bDirty;
+    /** Of all the members, for the cell's distance from the listeners. */
+    FBox Bounds;
+    /** Valid while a bake is running or waiting to be uploaded. */
+    TFuture<FCellMeshPtr> Bake;
+  };
+
+  /** What a bake needs of a member, read on the game thread. */
+  struct FBakeItem
+  {
+    FGeometryPtr Geometry;
+    FTransform Transform;
+    uint8 Material;
+  };
+
+  /** Something to do this frame: upload instance Instance of Jobs[Index], swap Residents[Index] to LOD, or upload or remove the cell at Cell. */
+  struct FUpload
+  {
+    enum class EKind : uint8 { Upload, Swap, Cell, StreamOut };
+    float DistSquared;
+    int32 Index;
+    int32 Instance;
+    int32 LOD;
+    EKind Kind;
+    FIntVector Cell;
+  };
+
+  /** The geometry of a mesh's collision data, or nullptr if it has none. Any thread. */
+  static FGeometryPtr Extract(FTriMeshCollisionData&& ColData, int32 ProxyTriangles, int32 NumLODs, float FeatureAngle);
+  /** Adds the mesh to Geometry as it is, or simplified into its levels of detail. Any thread. */
+  static void BuildLODs(FSpace3DUnrealCookedGeometry& Geometry, TArray<FVector>&& Vertices, TArray<FVector>&& Normals, TArray<int32>&& Indices, int32 ProxyTriangles, int32 NumLODs, float FeatureAngle);
+  /** Level of detail for Component at DistSquared from the listener, which now has Current (INDEX_NONE if not uploaded yet). */
+  static int32 ChooseLOD(const USpace3DUnrealMesh& Component, float DistSquared, int32 NumLODs, int32 Current);
+  /** Adds the LOD as a new mesh at Instance's transform on Component, hands its uuid to the instance's OnCreated and removes OldUuid (if not 0), under one API lock. Returns the new uuid, or 0 if the component no longer wanted it. */
+  static uint64_t Upload(const FSpace3DUnrealCookedGeometry::FLOD& LOD, const USpace3DUnrealMesh& Component, const FInstance& Instance, uint64_t T, uint64_t OldUuid);
+  /** Adds Job's instances to the cells they are in. */
+  void Merge(FJob& Job);
+  static void MarkDirty(FCell& Cell);
+  /** Starts baking Cell's members (those whose components are still there). Returns false if there are none left. */
+  static bool StartBake(FCell& Cell);
+  /** Bakes Items into one mesh. Any thread. */
+  static FCellMeshPtr BakeCell(const TArray<FBakeItem>& Items, float Scale);
+  /** Replaces Cell's mesh with its finished bake, under one API lock, and hands its uuid to the members. Returns false if the cell is left empty; its mesh has then been removed. */
+  static bool UploadCell(FCell& Cell, uint64_t T);
+
+  TArray<TUniquePtr<FJob>> Jobs;
+  TArray<FResident> Residents;
+  /** Extraction tasks by cache key, until they are done. */
+  TMap<FString, TSharedFuture<FGeometryPtr>> Pending;
+  /** Extracted geometry by cache key, while any job or resident still holds it. */
+  TMap<FString, TWeakPtr<FSpace3DUnrealCookedGeometry, ESPMode::ThreadSafe>> Shared;
+  TMap<FIntVector, FCell> Cells;
+  /** Scratch for Tick. */
+  TArray<FUpload> Ready;
+  std::atomic<float> BudgetMs;
+  std::atomic<float> CellSize;
+  std::atomic<float> StreamRadius;
+};
@@ -1,14 +1,35 @@
 #include "Space3DUnrealMeshes.h"
 #include "PhysXPublic.h"
 #include "SkeletalRenderPublic.h"
+#include "Async/ParallelFor.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Math/VectorRegister.h"
+#include "Space3DUnrealCommandBuffer.h"
+#include "Space3DUnrealClock.h"
+#include "Space3DUnrealMeshLoader.h"
 #include "Space3D.hpp"
 
+using EObject = FSpace3DUnrealCommandBuffer::EObject;
+
+namespace
+{
+  /** Below this many vertices, posing a skinned mesh on the game thread is quicker than waking task threads. */
+  constexpr int32 MinParallelPoseVertices = 4096;
+}
+
 FString LogText;
 
 USpace3DUnrealMesh::USpace3DUnrealMesh(const FObjectInitializer& ObjectInitializer)
   : Super(ObjectInitializer)
+  , RigidSegments(false)
+  , ProxyTriangles(0)
+  , ProxyLODs(1)
+  , ProxyLODDistance(5000.0f)
+  , ProxyFeatureAngle(30.0f)
   , bStatic(false)
-  , LastMaterialIndex(-1)
+  , bInstanced(false)
+  , bMerged(false)
+  , bSegmented(false)
   , NumVertices(0)
   , NumTriangles(0)
   , SkelComponent(nullptr)
@@ -18,14 +39,6 @@ USpace3DUnrealMesh::USpace3DUnrealMesh(const FObjectInitializer& ObjectInitializ
   //UE_LOG(LogSpace3DUnreal, Log, TEXT("USpace3DUnrealMesh::USpace3DUnrealMesh()"));
 }
 
-USpace3DUnrealMesh::~USpace3DUnrealMesh()
-{
-  for(int32 i=0; i<SkelSegments.Num(); ++i)
-  {
-    delete SkelSegments[i];
-  }
-}
-
 void USpace3DUnrealMesh::CreateS3DObject()
 {
   //UE_LOG(LogSpace3DUnreal, Log, TEXT("USpace3DUnrealMesh::CreateS3DObject()"));
@@ -34,18 +47,43 @@ void USpace3DUnrealMesh::CreateS3DObject()
 void USpace3DUnrealMesh::DestroyS3DObject()
 {
   //UE_LOG(LogSpace3DUnreal, Log, TEXT("USpace3DUnrealMesh::DestroyS3DObject()"));
-  if(uuid != 0) Space3D::MeshRemove(uuid);
+  FSpace3DUnrealCommandBuffer& Commands = Space3DUnreal::GetCommands();
+  if(bSegmented)
+  {
+    for(const FSkelSegment& Segment : SkelSegments)
+    {
+      if(Segment.uuid != 0) Commands.Remove(EObject::Mesh, Segment.uuid);
+    }
+  }
+  else if(bMerged)
+  {
+    //Its cells are rebuilt without it
+    Space3DUnreal::GetMeshLoader().Remove(this);
+  }
+  else if(bInstanced)
+  {
+    for(uint64_t InstanceUuid : InstanceUuids)
+    {
+      if(InstanceUuid != 0) Commands.Remove(EObject::Mesh, InstanceUuid);
+    }
+  }
+  else if(uuid != 0)
+  {
+    Commands.Remove(EObject::Mesh, uuid);
+  }
   bStatic = false;
-  LastMaterialIndex = -1;
+  bInstanced = false;
+  InstanceUuids.Empty();
+  bMerged = false;
+  bSegmented = false;
   NumVertices = NumTriangles = 0;
   SkelComponent = nullptr;
   SkelMesh = nullptr;
   SkelPhysAsset = nullptr;
-  for(int32 i=0; i<SkelSegments.Num(); ++i)
-  {
-    delete SkelSegments[i];
-  }
   SkelSegments.Empty();
+  SkelRestX.Empty();
+  SkelRestY.Empty();
+  SkelRestZ.Empty();
 }
 
 bool USpace3DUnrealMesh::RequiresScaleScale()
@@ -218,16 +256,40 @@ static void ImportConvex(int32& NumVertices, TArray<FVector>& Vertices, TArray<i
 }
 
 
-static void TransformInto(TArray<FVector>& Vertices, int32 VStartIdx, const TArray<FVector>& VerticesIn, const FTransform& BoneTransform)
+/** Out[v] = (X[v], Y[v], Z[v]) transformed by M, as FMatrix::TransformPosition, four vertices at a time. */
+static void TransformInto(FVector* Out, const float* X, const float* Y, const float* Z, int32 Num, const FMatrix& M)
 {
-  for(int v=0; v<VerticesIn.Num(); ++v)
+  const VectorRegister M00 = VectorSetFloat1(M.M[0][0]), M01 = VectorSetFloat1(M.M[0][1]), M02 = VectorSetFloat1(M.M[0][2]);
+  const VectorRegister M10 = VectorSetFloat1(M.M[1][0]), M11 = VectorSetFloat1(M.M[1][1]), M12 = VectorSetFloat1(M.M[1][2]);
+  const VectorRegister M20 = VectorSetFloat1(M.M[2][0]), M21 = VectorSetFloat1(M.M[2][1]), M22 = VectorSetFloat1(M.M[2][2]);
+  const VectorRegister M30 = VectorSetFloat1(M.M[3][0]), M31 = VectorSetFloat1(M.M[3][1]), M32 = VectorSetFloat1(M.M[3][2]);
+  int32 v = 0;
+  for(; v + 4 <= Num; v += 4)
+  {
+    VectorRegister VX = VectorLoad(X + v);
+    VectorRegister VY = VectorLoad(Y + v);
+    VectorRegister VZ = VectorLoad(Z + v);
+    VectorRegister OX = VectorMultiplyAdd(VZ, M20, VectorMultiplyAdd(VY, M10, VectorMultiplyAdd(VX, M00, M30)));
+    VectorRegister OY = VectorMultiplyAdd(VZ, M21, VectorMultiplyAdd(VY, M11, VectorMultiplyAdd(VX, M01, M31)));
+    VectorRegister OZ = VectorMultiplyAdd(VZ, M22, VectorMultiplyAdd(VY, M12, VectorMultiplyAdd(VX, M02, M32)));
+    //Back to packed xyz: x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3
+    VectorRegister A = VectorShuffle(VectorShuffle(OX, OY, 0, 0, 0, 0), VectorShuffle(OZ, OX, 0, 0, 1, 1), 0, 2, 0, 2);
+    VectorRegister B = VectorShuffle(VectorShuffle(OY, OZ, 1, 1, 1, 1), VectorShuffle(OX, OY, 2, 2, 2, 2), 0, 2, 0, 2);
+    VectorRegister C = VectorShuffle(VectorShuffle(OZ, OX, 2, 2, 3, 3), VectorShuffle(OY, OZ, 3, 3, 3, 3), 0, 2, 0, 2);
+    float* Dest = (float*)(Out + v);
+    VectorStore(A, Dest);
+    VectorStore(B, Dest + 4);
+    VectorStore(C, Dest + 8);
+  }
+  for(; v < Num; ++v)
   {
-    Vertices[VStartIdx+v] = BoneTransform.TransformPosition(VerticesIn[v]);
+    Out[v] = FVector(
+      X[v] * M.M[0][0] + Y[v] * M.M[1][0] + Z[v] * M.M[2][0] + M.M[3][0],
+      X[v] * M.M[0][1] + Y[v] * M.M[1][1] + Z[v] * M.M[2][1] + M.M[3][1],
+      X[v] * M.M[0][2] + Y[v] * M.M[1][2] + Z[v] * M.M[2][2] + M.M[3][2]);
   }
 }
 
-
-
 void USpace3DUnrealMesh::PreTick()
 {
   //UE_LOG(LogSpace3DUnreal, Log, TEXT("USpace3DUnrealMesh::PreTick()"));
@@ -251,12 +313,16 @@ void USpace3DUnrealMesh::PreTick()
   
   if(bStatic)
   {
-    check(uuid != 0);
     //No need to update the mesh again
     return;
   }
+  if(uuid == 0 && SkelComponent != nullptr)
+  {
+    //Recorded last time, not created yet
+    return;
+  }
   
-  bool bHaveLock = false;
+  FSpace3DUnrealCommandBuffer& Commands = Space3DUnreal::GetCommands();
   if(uuid == 0)
   {
     check(SkelComponent == nullptr);
@@ -268,52 +334,57 @@ void USpace3DUnrealMesh::PreTick()
     UStaticMeshComponent* StaticMeshC = Cast<UStaticMeshComponent>(Parent);
     if(StaticMeshC != nullptr)
     {
-      // Create and submit data for static mesh
+      // Extract and upload the static mesh in the background
       UE_LOG(LogSpace3DUnreal, Log, TEXT("%s: Creating static mesh"), *Owner->GetName());
       
-      IInterface_CollisionDataProvider* StaticColDataSrc = StaticMeshC->GetStaticMesh();
+      UStaticMesh* StaticMesh = StaticMeshC->GetStaticMesh();
       bStatic = true;
       
-      if(!StaticColDataSrc->ContainsPhysicsTriMeshData(true))
+      if(StaticMesh == nullptr || !StaticMesh->ContainsPhysicsTriMeshData(true))
       {
         UE_LOG(LogSpace3DUnreal, Error, TEXT("%s: CollisionDataProvider does not have physics tri mesh data"), *Owner->GetName());
 
         IntentionallyNotCreated = true;
         return;
       }
-    
-      FTriMeshCollisionData ColData;
-      if(!StaticColDataSrc->GetPhysicsTriMeshData(&ColData, true))
+      
+      //Geometry is shared with every other component using the same mesh; each instance is placed on its own, or merged into its cell if it never moves
+      FSpace3DUnrealMeshLoader& MeshLoader = Space3DUnreal::GetMeshLoader();
+      bMerged = MeshLoader.GetCellSize() > 0.0f && IsStaticAfterBeginPlay() && MotionPrediction == ESpace3DUnrealPrediction::None && !IsPosedExternally()
+        && (ProxyTriangles <= 0 || ProxyLODs <= 1);
+      TArray<FSpace3DUnrealMeshLoader::FInstance> Instances;
+      UInstancedStaticMeshComponent* InstancedC = Cast<UInstancedStaticMeshComponent>(StaticMeshC);
+      if(InstancedC != nullptr)
       {
-        UE_LOG(LogSpace3DUnreal, Error, TEXT("%s: Could not get collision tri mesh from CollisionDataProvider"), *Owner->GetName());
+        int32 NumInstances = InstancedC->GetInstanceCount();
+        if(NumInstances == 0)
+        {
+          UE_LOG(LogSpace3DUnreal, Warning, TEXT("%s: Instanced static mesh has no instances"), *Owner->GetName());
 
-        IntentionallyNotCreated = true;
-        return;
-      }
-      //"Indices" is actually triangles
-      NumVertices = ColData.Vertices.Num();
-      NumTriangles = ColData.Indices.Num();
-      const glm::vec3 *Normals = nullptr;
-      if(ColData.Normals.Num() > 0)
-      {
-        Normals = (const glm::vec3*)ColData.Normals.GetData();
-        /*
-        UE_LOG(LogSpace3DUnreal, Log, TEXT("    Normals:"));
-        for(int i=0; i<NumVertices && i<50; ++i)
+          IntentionallyNotCreated = true;
+          return;
+        }
+        bInstanced = true;
+        InstanceUuids.SetNumZeroed(NumInstances);
+        Instances.SetNum(NumInstances);
+        for(int32 n=0; n<NumInstances; ++n)
         {
-          UE_LOG(LogSpace3DUnreal, Log, TEXT("    (%f, %f, %f)"), Normals[i].x, Normals[i].y, Normals[i].z);
+          InstancedC->GetInstanceTransform(n, Instances[n].Transform, false);
+          Instances[n].OnCreated = MakeOnCreated([n](USpace3DUnrealComponent* Component, uint64_t NewUuid)
+          {
+            USpace3DUnrealMesh* Mesh = static_cast<USpace3DUnrealMesh*>(Component);
+            uint64_t& InstanceUuid = Mesh->InstanceUuids[n];
+            if(Mesh->uuid == 0 || Mesh->uuid == InstanceUuid) Mesh->uuid = NewUuid;
+            InstanceUuid = NewUuid;
+          });
         }
-        */
       }
       else
       {
-        UE_LOG(LogSpace3DUnreal, Warning, TEXT("%s: Static mesh does not have normals"), *Owner->GetName());
+        Instances.Add(FSpace3DUnrealMeshLoader::FInstance{FTransform::Identity, MakeOnCreated()});
       }
-      Space3D::BeginAtomicAccess();
-      uuid = Space3D::MeshAdd(NumVertices, NumTriangles, (const uint32_t*)ColData.Indices.GetData());
-      Space3D::MeshSetVertices(uuid, (const glm::vec3*)ColData.Vertices.GetData(), Normals, false);
-      Space3D::EndAtomicAccess();
-      UE_LOG(LogSpace3DUnreal, Log, TEXT("%s: Added static mesh"), *Owner->GetName());
+      MeshLoader.Load(this, StaticMesh, MoveTemp(Instances), bMerged);
+      UE_LOG(LogSpace3DUnreal, Log, TEXT("%s: Queued static mesh, %d instances"), *Owner->GetName(), bInstanced ? InstanceUuids.Num() : 1);
 
       return;
     }
@@ -348,6 +419,7 @@ void USpace3DUnrealMesh::PreTick()
       
     NumVertices = 0;
     TArray<int32> Indices;
+    TArray<FVector> SegVertices;
     
     //Code adapted from UPhysicsAsset::GetCollisionMesh and FKAggregateGeom::GetAggGeom
     for(int32 j=0; j<SkelPhysAsset->SkeletalBodySetups.Num(); ++j)
@@ -356,56 +428,69 @@ void USpace3DUnrealMesh::PreTick()
       //UE_LOG(LogSpace3DUnreal, Log, TEXT("Col mesh for %s"), *Setup->BoneName.ToString());
       if (Setup->bCreatedPhysicsMeshes)
       {
-        SegmentInfo* SegInfo = new SegmentInfo();
-        SegInfo->BodySetupIdx = j;
-        SegInfo->BoneIndex = SkelMesh->RefSkeleton.FindBoneIndex(Setup->BoneName);
-        check(SegInfo->BoneIndex >= 0);
+        FSkelSegment Segment;
+        Segment.BoneIndex = SkelMesh->RefSkeleton.FindBoneIndex(Setup->BoneName);
+        Segment.FirstVertex = NumVertices;
+        Segment.FirstIndex = Indices.Num();
+        Segment.uuid = 0;
+        Segment.bNew = true;
+        Segment.bMoving = false;
+        check(Segment.BoneIndex >= 0);
+        SegVertices.Reset();
         FKAggregateGeom* Agg = &Setup->AggGeom;
 
         for (int32 i = 0; i < Agg->BoxElems.Num(); i++)
         {
           //UE_LOG(LogSpace3DUnreal, Log, TEXT("--Importing box"));
           const FKBoxElem& Elem = Agg->BoxElems[i];
-          ImportBox(NumVertices, SegInfo->Vertices, Indices, Elem.GetTransform(), Elem.X, Elem.Y, Elem.Z);
+          ImportBox(NumVertices, SegVertices, Indices, Elem.GetTransform(), Elem.X, Elem.Y, Elem.Z);
         }
 
         for (int32 i = 0; i < Agg->SphereElems.Num(); i++)
         {
           //UE_LOG(LogSpace3DUnreal, Log, TEXT("--Importing sphere"));
           const FKSphereElem& Elem = Agg->SphereElems[i];
-          ImportSphere(NumVertices, SegInfo->Vertices, Indices, Elem.GetTransform(), Elem.Radius);
+          ImportSphere(NumVertices, SegVertices, Indices, Elem.GetTransform(), Elem.Radius);
         }
 
         for (int32 i = 0; i < Agg->SphylElems.Num(); i++)
         {
           //UE_LOG(LogSpace3DUnreal, Log, TEXT("--Importing capsule"));
           const FKSphylElem& Elem = Agg->SphylElems[i];
-          ImportTaperedCapsule(NumVertices, SegInfo->Vertices, Indices, Elem.GetTransform(), Elem.Length, Elem.Radius, Elem.Radius);
+          ImportTaperedCapsule(NumVertices, SegVertices, Indices, Elem.GetTransform(), Elem.Length, Elem.Radius, Elem.Radius);
         }
         
         for (int32 i = 0; i < Agg->TaperedCapsuleElems.Num(); i++)
         {
           //UE_LOG(LogSpace3DUnreal, Log, TEXT("--Importing tapered capsule"));
           const FKTaperedCapsuleElem& Elem = Agg->TaperedCapsuleElems[i];
-          ImportTaperedCapsule(NumVertices, SegInfo->Vertices, Indices, Elem.GetTransform(), Elem.Length, Elem.Radius0, Elem.Radius1);
+          ImportTaperedCapsule(NumVertices, SegVertices, Indices, Elem.GetTransform(), Elem.Length, Elem.Radius0, Elem.Radius1);
         }
         
         for (int32 i = 0; i < Agg->ConvexElems.Num(); i++)
         {
           const FKConvexElem& Elem = Agg->ConvexElems[i];
           //UE_LOG(LogSpace3DUnreal, Log, TEXT("--Importing convex"));
-          ImportConvex(NumVertices, SegInfo->Vertices, Indices, Elem);
+          ImportConvex(NumVertices, SegVertices, Indices, Elem);
         }
         
-        if(SegInfo->Vertices.Num() == 0)
+        if(SegVertices.Num() == 0)
         {
           UE_LOG(LogSpace3DUnreal, Warning, TEXT("%s: SkeletalBodySetup[%d] does not contain any geometry"), *Owner->GetName(), j);
-
-          delete SegInfo;
         }
         else
         {
-          SkelSegments.Add(SegInfo);
+          //Flattened into the rest-pose arrays
+          Segment.NumVertices = SegVertices.Num();
+          Segment.NumIndices = Indices.Num() - Segment.FirstIndex;
+          check(Segment.FirstVertex + Segment.NumVertices == NumVertices);
+          for(const FVector& V : SegVertices)
+          {
+            SkelRestX.Add(V.X);
+            SkelRestY.Add(V.Y);
+            SkelRestZ.Add(V.Z);
+          }
+          SkelSegments.Add(Segment);
         }
       }
       else
@@ -422,54 +507,155 @@ void USpace3DUnrealMesh::PreTick()
     }
     check(Indices.Num() % 3 == 0);
     NumTriangles = Indices.Num() / 3;
-    Space3D::BeginAtomicAccess();
-    bHaveLock = true;
-    uuid = Space3D::MeshAdd(NumVertices, NumTriangles, (const uint32_t*)Indices.GetData());
-    UE_LOG(LogSpace3DUnreal, Log, TEXT("%s: Added skeletal mesh"), *Owner->GetName());
+    if(RigidSegments)
+    {
+      //One mesh per segment, in bone space; only their transforms change from now on
+      bSegmented = true;
+      for(int32 Seg=0; Seg<SkelSegments.Num(); ++Seg)
+      {
+        const FSkelSegment& Segment = SkelSegments[Seg];
+        TArray<FVector> SegmentVertices;
+        SegmentVertices.SetNumUninitialized(Segment.NumVertices);
+        for(int32 v=0; v<Segment.NumVertices; ++v)
+        {
+          int32 r = Segment.FirstVertex + v;
+          SegmentVertices[v] = FVector(SkelRestX[r], SkelRestY[r], SkelRestZ[r]);
+        }
+        TArray<int32> SegmentIndices;
+        SegmentIndices.SetNumUninitialized(Segment.NumIndices);
+        for(int32 i=0; i<Segment.NumIndices; ++i)
+        {
+          SegmentIndices[i] = Indices[Segment.FirstIndex + i] - Segment.FirstVertex;
+        }
+        Commands.Add(EObject::Mesh, [SegmentIndices = MoveTemp(SegmentIndices), SegmentVertices = MoveTemp(SegmentVertices)]()
+        {
+          uint64_t NewUuid = Space3D::MeshAdd(SegmentVertices.Num(), SegmentIndices.Num() / 3, (const uint32_t*)SegmentIndices.GetData());
+          Space3D::MeshSetVertices(NewUuid, (const glm::vec3*)SegmentVertices.GetData(), nullptr, false);
+          return NewUuid;
+        }, MakeOnCreated([Seg](USpace3DUnrealComponent* Component, uint64_t NewUuid)
+        {
+          USpace3DUnrealMesh* Mesh = static_cast<USpace3DUnrealMesh*>(Component);
+          Mesh->SkelSegments[Seg].uuid = NewUuid;
+          if(Seg == 0) Mesh->uuid = NewUuid;
+        }));
+      }
+      UE_LOG(LogSpace3DUnreal, Log, TEXT("%s: Recorded skeletal mesh as %d rigid segments"), *Owner->GetName(), SkelSegments.Num());
+      return;
+    }
+    TArray<FVector> Vertices = Commands.AcquireVertexBuffer();
+    PoseVertices(Vertices);
+    Commands.Add(EObject::Mesh, [Indices = MoveTemp(Indices), Vertices = MoveTemp(Vertices)]()
+    {
+      uint64_t NewUuid = Space3D::MeshAdd(Vertices.Num(), Indices.Num() / 3, (const uint32_t*)Indices.GetData());
+      Space3D::MeshSetVertices(NewUuid, (const glm::vec3*)Vertices.GetData(), nullptr, false);
+      return NewUuid;
+    }, MakeOnCreated());
+    UE_LOG(LogSpace3DUnreal, Log, TEXT("%s: Recorded skeletal mesh"), *Owner->GetName());
+    return;
+  }
+  
+  if(bSegmented)
+  {
+    PoseSegments();
+    return;
   }
   
-  // Update skeletal mesh vertices
-  check(uuid != 0);
+  // Update skeletal mesh vertices, into storage recycled from an earlier upload
+  TArray<FVector> Vertices = Commands.AcquireVertexBuffer();
+  PoseVertices(Vertices);
+  Commands.SetMeshVertices(uuid, MoveTemp(Vertices), TArray<FVector>());
+}
+
+void USpace3DUnrealMesh::PoseVertices(TArray<FVector>& Vertices) const
+{
   check(SkelComponent != nullptr);
-  check(SkelMesh != nullptr);
-  check(SkelPhysAsset != nullptr);
   const TArray<FTransform>& SpaceBases = SkelComponent->GetComponentSpaceTransforms();
-  TArray<FVector> Vertices;
-  Vertices.AddDefaulted(NumVertices);
+  check(SkelRestX.Num() == NumVertices);
+  Vertices.SetNumUninitialized(NumVertices, false);
   
-  int32 v=0;
-  for(int32 s=0; s < SkelSegments.Num(); ++s)
+  FVector* Out = Vertices.GetData();
+  ParallelFor(SkelSegments.Num(), [&](int32 s)
   {
-    check(SkelSegments[s]->BodySetupIdx >= 0 && SkelSegments[s]->BodySetupIdx < SkelPhysAsset->SkeletalBodySetups.Num());
-    UBodySetup* Setup = SkelPhysAsset->SkeletalBodySetups[SkelSegments[s]->BodySetupIdx];
-    check(Setup->bCreatedPhysicsMeshes);
-    
-    check(SkelSegments[s]->BoneIndex >= 0 && SkelSegments[s]->BoneIndex < SpaceBases.Num());
-    check(SkelSegments[s]->Vertices.Num() > 0);
-    TransformInto(Vertices, v, SkelSegments[s]->Vertices, SpaceBases[SkelSegments[s]->BoneIndex]);
-    v += SkelSegments[s]->Vertices.Num();
-  }
-  check(v == NumVertices);
+    const FSkelSegment& Segment = SkelSegments[s];
+    check(Segment.BoneIndex >= 0 && Segment.BoneIndex < SpaceBases.Num());
+    int32 v = Segment.FirstVertex;
+    TransformInto(Out + v, SkelRestX.GetData() + v, SkelRestY.GetData() + v, SkelRestZ.GetData() + v, Segment.NumVertices, SpaceBases[Segment.BoneIndex].ToMatrixWithScale());
+  }, NumVertices < MinParallelPoseVertices);
+}
   
-  if(!bHaveLock)
+void USpace3DUnrealMesh::PoseSegments()
+{
+  FSpace3DUnrealCommandBuffer& Commands = Space3DUnreal::GetCommands();
+  const TArray<FTransform>& SpaceBases = SkelComponent->GetComponentSpaceTransforms();
+  const FTransform& ComponentToWorld = SkelComponent->GetComponentTransform();
+  float Scale = Space3DUnreal::GetScaleFactor();
+  bool bResync;
+  uint64_t T = Space3DUnreal::GetClock().Tick(bResync);
+  for(FSkelSegment& Segment : SkelSegments)
   {
-    Space3D::BeginAtomicAccess();
+    if(Segment.uuid == 0) continue; //Space3D failed to create it
+    check(Segment.BoneIndex >= 0 && Segment.BoneIndex < SpaceBases.Num());
+    FTransform World = SpaceBases[Segment.BoneIndex] * ComponentToWorld;
+    bool bChanged = Segment.bNew
+      || FVector::DistSquared(World.GetLocation(), Segment.Sent.GetLocation()) > FMath::Square(MotionPositionEpsilon)
+      || FMath::RadiansToDegrees(World.GetRotation().AngularDistance(Segment.Sent.GetRotation())) > MotionRotationEpsilon
+      || !World.GetScale3D().Equals(Segment.Sent.GetScale3D(), MotionScaleEpsilon);
+    bool bReset;
+    if(Segment.bNew || (bChanged && bResync))
+    {
+      bReset = true;
+      Segment.bMoving = false;
+    }
+    else if(bChanged)
+    {
+      bReset = false;
+      Segment.bMoving = true;
+    }
+    else if(Segment.bMoving)
+    {
+      //Just stopped; pin it where it is
+      bReset = true;
+      Segment.bMoving = false;
+    }
+    else
+    {
+      continue;
+    }
+    Segment.bNew = false;
+    Segment.Sent = World;
+    Commands.SetTransform(Segment.uuid, T, World.GetLocation() * Scale, World.GetRotation(), World.GetScale3D() * Scale, bReset);
   }
-  Space3D::MeshSetVertices(uuid, (const glm::vec3*)Vertices.GetData(), nullptr, false);
-  Space3D::EndAtomicAccess();
-  
-  /*
-  FMeshElementCollector Collector;
-  int32 ViewIndex = 0;
-  SkelPhysAsset->GetCollisionMesh(ViewIndex, Collector, SkelMesh, SkelComponent->GetComponentSpaceTransforms(), SkelComponent->GetComponentTransform(), FVector(1.0f, 1.0f, 1.0f));
-  */
 }
-  
+
 void USpace3DUnrealMesh::UpdateS3DProps()
 {
-  if(MaterialIndex != LastMaterialIndex)
+  FSpace3DUnrealCommandBuffer& Commands = Space3DUnreal::GetCommands();
+  if(bMerged)
+  {
+    //Materials are per vertex in the merged cells
+    return;
+  }
+  if(bInstanced)
   {
-    Space3D::MeshSetMaterial(uuid, MaterialIndex);
-    LastMaterialIndex = MaterialIndex;
+    for(uint64_t InstanceUuid : InstanceUuids)
+    {
+      if(InstanceUuid != 0) Commands.SetProp(InstanceUuid, FSpace3DUnrealCommandBuffer::EProp::MeshMaterial, MaterialIndex);
+    }
+    return;
+  }
+  if(!bSegmented)
+  {
+    Commands.SetProp(uuid, FSpace3DUnrealCommandBuffer::EProp::MeshMaterial, MaterialIndex);
+    return;
   }
+  for(const FSkelSegment& Segment : SkelSegments)
+  {
+    if(Segment.uuid != 0) Commands.SetProp(Segment.uuid, FSpace3DUnrealCommandBuffer::EProp::MeshMaterial, MaterialIndex);
+  }
+}
+
+bool USpace3DUnrealMesh::IsPosedExternally() const
+{
+  //Segments are posed from their bones in PreTick, and instances and merged cells are placed by the mesh loader
+  return Super::IsPosedExternally() || bSegmented || bInstanced || bMerged;
 }
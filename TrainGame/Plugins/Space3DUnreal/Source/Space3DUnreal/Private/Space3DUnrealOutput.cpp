@@ -1,4 +1,8 @@
 #include "Space3DUnrealOutput.h"
+#include "Space3DUnrealFrameQueue.h"
+#include "Space3DUnrealGovernor.h"
+#include "Space3DUnrealDryPath.h"
+#include "Space3DUnrealMeshLoader.h"
 
 #include "Space3D.hpp"
 
@@ -31,8 +35,8 @@ void FSpace3DUnrealOutput::Init(const FSoundEffectSubmixInitData& InitData)
 {
   check(Space3DUnreal::IsActive());
   // if(!CheckGrabMainOutput()) return;
+  //Space3D's sample rate is set by the spatializer, which may run it at an internal rate (see InternalSampleRate)
   UE_LOG(LogSpace3DUnreal, Display, TEXT("FSpace3DUnrealOutput Init %f Hz"), InitData.SampleRate);
-  Space3D::GetParams()->fs = InitData.SampleRate;
 }
 
 void FSpace3DUnrealOutput::OnPresetChanged()
@@ -100,12 +104,32 @@ void FSpace3DUnrealOutput::OnPresetChanged()
   p->space3d_headextradelay = Settings.HeadExtraDelay;
   p->space3d_delaychangefactor = Settings.DelayChangeFactor;
   Space3D::SpeakersSetArrangeMode(static_cast<Space3D::SpkrArrangeMode>(Settings.SpeakersArrangeMode));
+  Space3DUnreal::SetRenderWorkerConfig(Settings.ProcessOnRenderWorker, Settings.RenderWorkerBuffers);
+  Space3DUnreal::SetFrameLengthConfig(Settings.FrameLength);
+  Space3DUnreal::SetInternalSampleRateConfig(Settings.InternalSampleRate);
+  
+  FSpace3DUnrealGovernor::FConfig Governor;
+  Governor.bEnabled = Settings.EnableGovernor;
+  Governor.Ceiling = { Settings.Order, Settings.RTRays, Settings.RTBranches, Settings.DiffNAngles };
+  Governor.Floor = { Settings.MinOrder, Settings.MinRTRays, Settings.MinRTBranches, Settings.MinDiffNAngles };
+  Governor.NumTiers = Settings.GovernorTiers;
+  Governor.DownLoad = Settings.GovernorDownLoad;
+  Governor.UpLoad = Settings.GovernorUpLoad;
+  Governor.DownFrames = Settings.GovernorDownFrames;
+  Governor.UpFrames = Settings.GovernorUpFrames;
+  Space3DUnreal::GetGovernor().Configure(Governor);
+  Space3DUnreal::GetDryPath().SetConfig(Settings.EnableDryFallback, Settings.DryFallbackDeadline, Settings.DryFallbackCrossfadeMs);
+  Space3DUnreal::GetMeshLoader().SetBudgetMs(Settings.MeshUploadBudgetMs);
+  Space3DUnreal::GetMeshLoader().SetCellSize(Settings.StaticMeshCellSize);
+  Space3DUnreal::GetMeshLoader().SetStreamRadius(Settings.StaticMeshStreamRadius);
 }
 
 void FSpace3DUnrealOutput::OnProcessAudio(const FSoundEffectSubmixInputData& InData, FSoundEffectSubmixOutputData& OutData)
 {
   check(Space3DUnreal::IsActive());
+  Space3DUnreal::SetNumOutputChannelsPlayed(OutData.NumChannels);
   bool NoOutput = false;
+  FSpace3DUnrealFrameQueue& Queue = Space3DUnreal::GetFrameQueue();
 
   
   /*
@@ -113,49 +137,25 @@ void FSpace3DUnrealOutput::OnProcessAudio(const FSoundEffectSubmixInputData& InD
   {
     NoOutput = true;
   }
-
-
-  else
   */
+  if(OutData.NumChannels > Queue.NumChannels())
   {
-    uint32_t NBuffers = Space3DUnreal::GetAndConsumeOutputAudio();
-    if(NBuffers > 1)
-    {
-      UE_LOG(LogSpace3DUnreal, Display, TEXT("Process called %d times before output. This is normal once when starting up, otherwise an issue."), NBuffers);
-    }
-    else if(NBuffers == 0)
-    {
-      NoOutput = true;
-    }
-    if(Space3D::FrameLength() != InData.NumFrames)
-    {
-      UE_LOG(LogSpace3DUnreal, Display, TEXT("Output wrong frame length %d"), InData.NumFrames);
-      NoOutput = true;
-    }
+    UE_LOG(LogSpace3DUnreal, Display, TEXT("Output has more channels (%d) than Space3D (%d)"), OutData.NumChannels, Queue.NumChannels());
+    NoOutput = true;
   }
 
   if(NoOutput)
   {
     //Clear output audio
-    for(int32 i=0; i<OutData.AudioBuffer->Num(); ++i)
-    {
-      (*OutData.AudioBuffer)[i] = 0.0f;
-    }
+    FMemory::Memset(OutData.AudioBuffer->GetData(), 0, OutData.AudioBuffer->Num() * sizeof(float));
     return;
   }
   
   check(OutData.AudioBuffer->Num() == InData.NumFrames * OutData.NumChannels);
-  check(OutData.NumChannels <= (int32)Space3D::OutputChannelCount());
-  float* Temp = new float[InData.NumFrames];
-  for(int32 c=0; c<OutData.NumChannels; ++c)
-  {
-    Space3D::OutputChannelRead(c, (audiofloat*)Temp);
-    for(int32 s=0; s<InData.NumFrames; ++s)
-    {
-      (*OutData.AudioBuffer)[s*OutData.NumChannels+c] = Temp[s];
-    }
-  }
-  delete[] Temp;
+  //Rebuffers from Space3D's frame length to the engine buffer size. Frames which are late, duplicated or missing are counted by the queue; see UViewerBP::GetFrameStats
+  int32 NumRendered = Queue.Read(OutData.AudioBuffer->GetData(), OutData.NumChannels, InData.NumFrames);
+  //Covers for Space3D with the direct path only while it is stalled or late
+  Space3DUnreal::GetDryPath().Mix(OutData.AudioBuffer->GetData(), OutData.NumChannels, InData.NumFrames, NumRendered);
 }
 
 void USpace3DUnrealOutputPreset::SetSettings(const FSpace3DUnrealOutputSettings& InSettings)
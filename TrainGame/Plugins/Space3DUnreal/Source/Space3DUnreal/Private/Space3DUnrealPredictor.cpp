@@ -0,0 +1,49 @@
+#include "Space3DUnrealPredictor.h"
+#include "Space3DUnreal.h"
+
+#include "Space3D.hpp"
+
+namespace
+{
+  /** Never extrapolate a sample further than this, either way; an object not updated for this long is more likely to have stopped than to still be going. */
+  constexpr double MaxHorizon = 0.25;
+}
+
+void FSpace3DUnrealPredictor::Set(const FSample& Sample)
+{
+  StagedSamples.Add(Sample);
+}
+
+void FSpace3DUnrealPredictor::Remove(uint64_t uuid)
+{
+  StagedRemovals.Add(uuid);
+}
+
+void FSpace3DUnrealPredictor::Commit()
+{
+  if(StagedSamples.Num() == 0 && StagedRemovals.Num() == 0) return;
+  {
+    FScopeLock ScopeLock(&Lock);
+    for(const FSample& Sample : StagedSamples) Objects.Add(Sample.uuid, Sample);
+    //Removals last: an object unregistered in the same frame it was sampled must not linger
+    for(uint64_t uuid : StagedRemovals) Objects.Remove(uuid);
+  }
+  StagedSamples.Reset();
+  StagedRemovals.Reset();
+}
+
+void FSpace3DUnrealPredictor::ApplyToObjects(uint64_t T)
+{
+  FScopeLock ScopeLock(&Lock);
+  for(const TPair<uint64_t, FSample>& Pair : Objects)
+  {
+    const FSample& S = Pair.Value;
+    double dt = T >= S.T ? (double)(T - S.T) * 1.0e-9 : -(double)(S.T - T) * 1.0e-9;
+    float t = (float)FMath::Clamp(dt, -MaxHorizon, MaxHorizon);
+    FVector Position = S.Position + S.Velocity * t + S.Acceleration * (0.5f * t * t);
+    FQuat Rotation = S.Rotation;
+    float Speed = S.AngularVelocity.Size();
+    if(Speed > KINDA_SMALL_NUMBER) Rotation = FQuat(S.AngularVelocity / Speed, Speed * t) * Rotation;
+    Space3D::PhysReset(S.uuid, T, U2GV(Position), U2GQ(Rotation), U2GV(S.Scale));
+  }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+
+/**
+Extrapolates moving objects from their velocity on the audio side, so their components can send updates at a fraction of the frame rate.
+
+Space3D only knows how an object moves from the last few PhysUpdate points, and at train speeds its extrapolation drifts quickly once those are more than a frame or two old. Instead, each update for a predicted object carries its linear and angular velocity (and optionally acceleration) as well as its transform, and from Space3D's physics callback, at the as_of_time of each Process call, the object is PhysReset to that sample advanced with a constant-velocity or constant-acceleration model. Samples are only extrapolated up to MaxHorizon; past that the object holds still until the next update.
+
+The game thread stages samples and removals during the frame and commits them in one batch; the audio thread applies them. Both take a lock.
+*/
+class FSpace3DUnrealPredictor
+{
+public:
+  /** One update, in Space3D units, at Space3D time T. */
+  struct FSample
+  {
+    uint64_t uuid;
+    uint64_t T;
+    FVector Position, Scale;
+    FQuat Rotation;
+    /** Units per second, rotation axis times radians per second, and units per second squared. */
+    FVector Velocity, AngularVelocity, Acceleration;
+  };
+
+  /** Game thread: replaces the object's sample, or stops predicting it, as of the next Commit. */
+  void Set(const FSample& Sample);
+  void Remove(uint64_t uuid);
+  /** Game thread: publishes everything staged since the last call. */
+  void Commit();
+
+  /** Audio thread, from the Space3D physics callback: PhysResets every predicted object to where it is at T. */
+  void ApplyToObjects(uint64_t T);
+
+private:
+  TArray<FSample> StagedSamples;
+  TArray<uint64_t> StagedRemovals;
+
+  FCriticalSection Lock;
+  TMap<uint64_t, FSample> Objects;
+};
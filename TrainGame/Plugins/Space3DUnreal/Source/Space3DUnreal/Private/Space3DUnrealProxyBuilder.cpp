@@ -0,0 +1,280 @@
+#include "Space3DUnrealProxyBuilder.h"
+
+namespace
+{
+  /** Weight of the constraint planes along boundary and feature edges, relative to the faces' own planes (which are weighted by area). */
+  constexpr double FeatureEdgeWeight = 100.0;
+  /** A collapse is skipped if it turns any remaining triangle's normal by more than about 80 degrees. */
+  constexpr float MinNormalDot = 0.2f;
+
+  uint64 EdgeKey(int32 A, int32 B)
+  {
+    return A < B ? ((uint64)A << 32) | (uint32)B : ((uint64)B << 32) | (uint32)A;
+  }
+
+  FVector FaceNormal(const FVector& P0, const FVector& P1, const FVector& P2)
+  {
+    return (P1 - P0) ^ (P2 - P0);
+  }
+
+  /** The two faces (or first two, if non-manifold) on an edge. */
+  struct FEdgeFaces
+  {
+    int32 Tri0, Tri1, Count;
+  };
+}
+
+FSpace3DUnrealProxyBuilder::FQuadric::FQuadric()
+{
+  FMemory::Memzero(A);
+}
+
+FSpace3DUnrealProxyBuilder::FQuadric::FQuadric(const FVector& Normal, double D, double Weight)
+{
+  double a = Normal.X, b = Normal.Y, c = Normal.Z;
+  A[0] = Weight * a * a; A[1] = Weight * a * b; A[2] = Weight * a * c; A[3] = Weight * a * D;
+  A[4] = Weight * b * b; A[5] = Weight * b * c; A[6] = Weight * b * D;
+  A[7] = Weight * c * c; A[8] = Weight * c * D;
+  A[9] = Weight * D * D;
+}
+
+FSpace3DUnrealProxyBuilder::FQuadric& FSpace3DUnrealProxyBuilder::FQuadric::operator+=(const FQuadric& Other)
+{
+  for(int32 i=0; i<10; ++i) A[i] += Other.A[i];
+  return *this;
+}
+
+double FSpace3DUnrealProxyBuilder::FQuadric::Eval(const FVector& P) const
+{
+  double x = P.X, y = P.Y, z = P.Z;
+  return A[0] * x * x + 2.0 * A[1] * x * y + 2.0 * A[2] * x * z + 2.0 * A[3] * x
+    + A[4] * y * y + 2.0 * A[5] * y * z + 2.0 * A[6] * y
+    + A[7] * z * z + 2.0 * A[8] * z
+    + A[9];
+}
+
+bool FSpace3DUnrealProxyBuilder::FQuadric::Minimum(FVector& Out) const
+{
+  //Solve the symmetric 3x3 system by its adjugate
+  double a = A[0], b = A[1], c = A[2], e = A[4], f = A[5], h = A[7];
+  double c00 = e * h - f * f, c01 = c * f - b * h, c02 = b * f - c * e;
+  double c11 = a * h - c * c, c12 = b * c - a * f, c22 = a * e - b * b;
+  double Det = a * c00 + b * c01 + c * c02;
+  if(FMath::Abs(Det) <= 1.0e-9 * FMath::Abs(a * e * h) || Det == 0.0) return false;
+  double r0 = -A[3], r1 = -A[6], r2 = -A[8];
+  Out = FVector(
+    (float)((c00 * r0 + c01 * r1 + c02 * r2) / Det),
+    (float)((c01 * r0 + c11 * r1 + c12 * r2) / Det),
+    (float)((c02 * r0 + c12 * r1 + c22 * r2) / Det));
+  return !Out.ContainsNaN();
+}
+
+FSpace3DUnrealProxyBuilder::FSpace3DUnrealProxyBuilder(const FVector* Vertices, int32 NumVertices, const int32* Indices, int32 NumIndices, float FeatureAngle)
+  : NumTriangles(0)
+{
+  //Collision meshes often split vertices along seams; weld them so the surface is connected
+  TMap<FVector, int32> Welded;
+  TArray<int32> Remap;
+  Remap.SetNumUninitialized(NumVertices);
+  for(int32 v=0; v<NumVertices; ++v)
+  {
+    int32* Found = Welded.Find(Vertices[v]);
+    if(Found != nullptr)
+    {
+      Remap[v] = *Found;
+      continue;
+    }
+    Remap[v] = Positions.Add(Vertices[v]);
+    Welded.Add(Vertices[v], Remap[v]);
+  }
+  int32 Num = Positions.Num();
+  Quadrics.SetNum(Num);
+  Versions.SetNumZeroed(Num);
+  VertexRemoved.SetNumZeroed(Num);
+  VertexTris.SetNum(Num);
+
+  for(int32 i=0; i+2<NumIndices; i+=3)
+  {
+    FIntVector Tri(Remap[Indices[i]], Remap[Indices[i + 1]], Remap[Indices[i + 2]]);
+    if(Tri.X == Tri.Y || Tri.Y == Tri.Z || Tri.Z == Tri.X) continue;
+    int32 t = Tris.Add(Tri);
+    for(int32 k=0; k<3; ++k) VertexTris[Tri[k]].Add(t);
+  }
+  NumTriangles = Tris.Num();
+  TriRemoved.SetNumZeroed(NumTriangles);
+
+  //Each face's plane, weighted by its area, on its corners
+  TArray<FVector> Normals;
+  Normals.SetNumUninitialized(NumTriangles);
+  TMap<uint64, FEdgeFaces> Edges;
+  for(int32 t=0; t<NumTriangles; ++t)
+  {
+    const FIntVector& Tri = Tris[t];
+    FVector N = FaceNormal(Positions[Tri.X], Positions[Tri.Y], Positions[Tri.Z]);
+    float Area2 = N.Size();
+    Normals[t] = Area2 > 0.0f ? N / Area2 : FVector::ZeroVector;
+    FQuadric Q(Normals[t], -(Normals[t] | Positions[Tri.X]), 0.5 * Area2);
+    for(int32 k=0; k<3; ++k)
+    {
+      Quadrics[Tri[k]] += Q;
+      FEdgeFaces& Edge = Edges.FindOrAdd(EdgeKey(Tri[k], Tri[(k + 1) % 3]), FEdgeFaces{t, INDEX_NONE, 0});
+      if(Edge.Count == 1) Edge.Tri1 = t;
+      ++Edge.Count;
+    }
+  }
+
+  //Boundary and feature edges: planes through the edge, perpendicular to its faces, keep its vertices on it
+  float MaxDot = FMath::Cos(FMath::DegreesToRadians(FeatureAngle));
+  for(const TPair<uint64, FEdgeFaces>& Pair : Edges)
+  {
+    const FEdgeFaces& Edge = Pair.Value;
+    bool bFeature = Edge.Count != 2 || (Normals[Edge.Tri0] | Normals[Edge.Tri1]) < MaxDot;
+    if(!bFeature) continue;
+    int32 V0 = (int32)(Pair.Key >> 32), V1 = (int32)(Pair.Key & 0xFFFFFFFFull);
+    FVector Dir = Positions[V1] - Positions[V0];
+    double Weight = FeatureEdgeWeight * Dir.SizeSquared();
+    for(int32 t : {Edge.Tri0, Edge.Tri1})
+    {
+      if(t == INDEX_NONE) continue;
+      FVector N = (Dir ^ Normals[t]).GetSafeNormal();
+      if(N.IsZero()) continue;
+      FQuadric Q(N, -(N | Positions[V0]), Weight);
+      Quadrics[V0] += Q;
+      Quadrics[V1] += Q;
+    }
+  }
+
+  Heap.Reserve(Edges.Num());
+  for(const TPair<uint64, FEdgeFaces>& Pair : Edges)
+  {
+    Heap.Add(MakeCollapse((int32)(Pair.Key >> 32), (int32)(Pair.Key & 0xFFFFFFFFull)));
+  }
+  Heap.Heapify([](const FCollapse& A, const FCollapse& B) { return A.Cost < B.Cost; });
+}
+
+FSpace3DUnrealProxyBuilder::FCollapse FSpace3DUnrealProxyBuilder::MakeCollapse(int32 V0, int32 V1) const
+{
+  FQuadric Q = Quadrics[V0];
+  Q += Quadrics[V1];
+  const FVector& P0 = Positions[V0];
+  const FVector& P1 = Positions[V1];
+  FCollapse C;
+  C.V0 = V0;
+  C.V1 = V1;
+  C.Version0 = Versions[V0];
+  C.Version1 = Versions[V1];
+  //The optimum, unless it is far off the edge (nearly flat areas); otherwise the best of the ends and middle
+  FVector Mid = (P0 + P1) * 0.5f;
+  if(Q.Minimum(C.Target) && FVector::DistSquared(C.Target, Mid) <= FVector::DistSquared(P0, P1))
+  {
+    C.Cost = Q.Eval(C.Target);
+  }
+  else
+  {
+    C.Target = Mid;
+    C.Cost = Q.Eval(Mid);
+    for(const FVector& P : {P0, P1})
+    {
+      double Cost = Q.Eval(P);
+      if(Cost < C.Cost)
+      {
+        C.Cost = Cost;
+        C.Target = P;
+      }
+    }
+  }
+  C.Cost = FMath::Max(C.Cost, 0.0);
+  return C;
+}
+
+bool FSpace3DUnrealProxyBuilder::Flips(int32 V, int32 Other, const FVector& Target) const
+{
+  for(int32 t : VertexTris[V])
+  {
+    if(TriRemoved[t]) continue;
+    const FIntVector& Tri = Tris[t];
+    if(Tri.X == Other || Tri.Y == Other || Tri.Z == Other) continue; //Goes away
+    FVector P[3] = { Positions[Tri.X], Positions[Tri.Y], Positions[Tri.Z] };
+    FVector Before = FaceNormal(P[0], P[1], P[2]).GetSafeNormal();
+    for(int32 k=0; k<3; ++k)
+    {
+      if(Tri[k] == V) P[k] = Target;
+    }
+    FVector After = FaceNormal(P[0], P[1], P[2]).GetSafeNormal();
+    if(After.IsZero() || (Before | After) < MinNormalDot) return true;
+  }
+  return false;
+}
+
+void FSpace3DUnrealProxyBuilder::Collapse(const FCollapse& C)
+{
+  int32 V0 = C.V0, V1 = C.V1;
+  Positions[V0] = C.Target;
+  Quadrics[V0] += Quadrics[V1];
+  for(int32 t : VertexTris[V1])
+  {
+    if(TriRemoved[t]) continue;
+    FIntVector& Tri = Tris[t];
+    if(Tri.X == V0 || Tri.Y == V0 || Tri.Z == V0)
+    {
+      TriRemoved[t] = true;
+      --NumTriangles;
+      continue;
+    }
+    for(int32 k=0; k<3; ++k)
+    {
+      if(Tri[k] == V1) Tri[k] = V0;
+    }
+    VertexTris[V0].Add(t);
+  }
+  VertexTris[V1].Empty();
+  VertexRemoved[V1] = true;
+  VertexTris[V0].RemoveAll([this](int32 t) { return TriRemoved[t]; });
+  ++Versions[V0];
+
+  //Every edge of V0 has a new cost now
+  TArray<int32, TInlineAllocator<32>> Neighbours;
+  for(int32 t : VertexTris[V0])
+  {
+    const FIntVector& Tri = Tris[t];
+    for(int32 k=0; k<3; ++k)
+    {
+      if(Tri[k] != V0) Neighbours.AddUnique(Tri[k]);
+    }
+  }
+  for(int32 N : Neighbours)
+  {
+    Heap.HeapPush(MakeCollapse(V0, N), [](const FCollapse& A, const FCollapse& B) { return A.Cost < B.Cost; });
+  }
+}
+
+void FSpace3DUnrealProxyBuilder::Simplify(int32 TargetTriangles)
+{
+  while(NumTriangles > TargetTriangles && Heap.Num() > 0)
+  {
+    FCollapse C;
+    Heap.HeapPop(C, [](const FCollapse& A, const FCollapse& B) { return A.Cost < B.Cost; }, false);
+    if(VertexRemoved[C.V0] || VertexRemoved[C.V1]) continue;
+    if(Versions[C.V0] != C.Version0 || Versions[C.V1] != C.Version1) continue; //Stale
+    if(Flips(C.V0, C.V1, C.Target) || Flips(C.V1, C.V0, C.Target)) continue;
+    Collapse(C);
+  }
+}
+
+void FSpace3DUnrealProxyBuilder::GetMesh(TArray<FVector>& OutVertices, TArray<int32>& OutIndices) const
+{
+  OutVertices.Reset();
+  OutIndices.Reset(NumTriangles * 3);
+  TArray<int32> Remap;
+  Remap.Init(INDEX_NONE, Positions.Num());
+  for(int32 t=0; t<Tris.Num(); ++t)
+  {
+    if(TriRemoved[t]) continue;
+    for(int32 k=0; k<3; ++k)
+    {
+      int32 v = Tris[t][k];
+      if(Remap[v] == INDEX_NONE) Remap[v] = OutVertices.Add(Positions[v]);
+      OutIndices.Add(Remap[v]);
+    }
+  }
+}
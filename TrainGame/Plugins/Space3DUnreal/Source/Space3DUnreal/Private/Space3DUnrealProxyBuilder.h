@@ -0,0 +1,64 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+Simplifies a triangle mesh into an acoustic proxy with a triangle budget, by quadric error edge collapse (Garland and Heckbert).
+
+Render-resolution collision meshes have far more detail than sound at audible wavelengths can resolve, and Space3D's ray tracing and BVH rebuilds cost in proportion to the number of triangles. Edges are collapsed cheapest first, each to the point which least moves the surfaces around it, until the mesh is within budget. Open boundaries and feature edges, where the faces meet at more than FeatureAngle, are held in place by extra constraint planes, since those are the edges sound diffracts around; flat and gently curved areas are simplified first. Collapses which would fold a triangle over are skipped.
+
+Simplify can be called again with smaller budgets to get successively coarser levels of detail from the same builder. Any thread; one builder per thread.
+*/
+class FSpace3DUnrealProxyBuilder
+{
+public:
+  /** Copies the mesh, welding vertices at the same position. FeatureAngle in degrees. */
+  FSpace3DUnrealProxyBuilder(const FVector* Vertices, int32 NumVertices, const int32* Indices, int32 NumIndices, float FeatureAngle);
+
+  /** Collapses edges until at most TargetTriangles remain, or nothing more can be collapsed. */
+  void Simplify(int32 TargetTriangles);
+  int32 GetNumTriangles() const { return NumTriangles; }
+  /** The mesh as simplified so far, without unused vertices. */
+  void GetMesh(TArray<FVector>& OutVertices, TArray<int32>& OutIndices) const;
+
+private:
+  /** Symmetric 4x4 error quadric, upper triangle: sum over planes of the squared distance to them. */
+  struct FQuadric
+  {
+    double A[10];
+
+    FQuadric();
+    /** Plane Normal . p + D = 0, times Weight. */
+    FQuadric(const FVector& Normal, double D, double Weight);
+    FQuadric& operator+=(const FQuadric& Other);
+    double Eval(const FVector& P) const;
+    /** The point of least error, unless the quadric is (near) singular. */
+    bool Minimum(FVector& Out) const;
+  };
+
+  /** A candidate edge collapse, V1 into V0, valid while neither vertex has changed since. */
+  struct FCollapse
+  {
+    double Cost;
+    int32 V0, V1;
+    uint32 Version0, Version1;
+    FVector Target;
+  };
+
+  FCollapse MakeCollapse(int32 V0, int32 V1) const;
+  /** Whether moving V to Target would flip or degenerate any of its triangles which don't also contain Other. */
+  bool Flips(int32 V, int32 Other, const FVector& Target) const;
+  void Collapse(const FCollapse& C);
+
+  TArray<FVector> Positions;
+  TArray<FQuadric> Quadrics;
+  TArray<uint32> Versions;
+  TArray<bool> VertexRemoved;
+  /** Triangles around each vertex; may include removed ones. */
+  TArray<TArray<int32>> VertexTris;
+  TArray<FIntVector> Tris;
+  TArray<bool> TriRemoved;
+  int32 NumTriangles;
+  /** Min-heap on cost, with stale entries skipped as they come up. */
+  TArray<FCollapse> Heap;
+};
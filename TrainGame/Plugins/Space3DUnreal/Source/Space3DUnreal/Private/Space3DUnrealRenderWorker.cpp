@@ -0,0 +1,55 @@
+#include "Space3DUnrealRenderWorker.h"
+#include "Space3DUnreal.h"
+#include "HAL/RunnableThread.h"
+
+FSpace3DUnrealRenderWorker::FSpace3DUnrealRenderWorker()
+  : NumKicks(0)
+  , bStopping(false)
+{
+  WakeEvent = FPlatformProcess::GetSynchEventFromPool(false);
+  Thread = FRunnableThread::Create(this, TEXT("Space3DRenderWorker"), 0, TPri_Highest);
+  UE_LOG(LogSpace3DUnreal, Display, TEXT("Space3D render worker started"));
+}
+
+FSpace3DUnrealRenderWorker::~FSpace3DUnrealRenderWorker()
+{
+  if(Thread != nullptr)
+  {
+    Thread->Kill(true);
+    delete Thread;
+    Thread = nullptr;
+  }
+  FPlatformProcess::ReturnSynchEventToPool(WakeEvent);
+  WakeEvent = nullptr;
+  UE_LOG(LogSpace3DUnreal, Display, TEXT("Space3D render worker stopped"));
+}
+
+void FSpace3DUnrealRenderWorker::Kick()
+{
+  NumKicks.fetch_add(1, std::memory_order_release);
+  WakeEvent->Trigger();
+}
+
+uint32 FSpace3DUnrealRenderWorker::Run()
+{
+  uint64_t Done = 0;
+  while(!bStopping.load(std::memory_order_relaxed))
+  {
+    uint64_t Kicks = NumKicks.load(std::memory_order_acquire);
+    if(Kicks == Done)
+    {
+      WakeEvent->Wait();
+      continue;
+    }
+    //If we fell behind, the input FIFO skips its oldest frames to catch up, and the frame queue sees them as dropped
+    Done = Kicks;
+    Space3DUnreal::RenderFrames();
+  }
+  return 0;
+}
+
+void FSpace3DUnrealRenderWorker::Stop()
+{
+  bStopping.store(true);
+  WakeEvent->Trigger();
+}
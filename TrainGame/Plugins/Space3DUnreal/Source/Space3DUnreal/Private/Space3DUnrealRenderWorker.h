@@ -0,0 +1,32 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+
+#include <atomic>
+
+/**
+Runs Space3D::Process on a dedicated high-priority thread, one frame behind the audio render thread.
+
+Each buffer, the spatializer pushes the sources' input to the input FIFO (see FSpace3DUnrealInputFifo) and calls Kick(). The worker processes every full frame waiting there while the mixer carries on, and publishes the rendered output to the frame queue (see FSpace3DUnrealFrameQueue), which the output submix plays from. Since the submix plays the oldest queued frame, output runs one buffer behind and Process time jitter of up to one buffer no longer causes underruns.
+
+Kick() must be called from the audio render thread.
+*/
+class FSpace3DUnrealRenderWorker : public FRunnable
+{
+public:
+  FSpace3DUnrealRenderWorker();
+  virtual ~FSpace3DUnrealRenderWorker();
+  
+  /** Starts processing the input which was just pushed. */
+  void Kick();
+  
+  virtual uint32 Run() override;
+  virtual void Stop() override;
+  
+private:
+  std::atomic<uint64_t> NumKicks;
+  std::atomic<bool> bStopping;
+  FEvent* WakeEvent;
+  FRunnableThread* Thread;
+};
@@ -0,0 +1,94 @@
+#include "Space3DUnrealResampler.h"
+#include "Space3DUnrealDSP.h"
+
+FSpace3DUnrealResampler::FSpace3DUnrealResampler() : Up(1), Down(1), NumTaps(4), MaxIn(0), Phase(0)
+{
+}
+
+void FSpace3DUnrealResampler::Configure(float InRate, float OutRate, int32 MaxInput)
+{
+  int32 InHz = FMath::RoundToInt(InRate);
+  int32 OutHz = FMath::RoundToInt(OutRate);
+  check(InHz > 0 && OutHz > 0);
+  int32 Divisor = FMath::GreatestCommonDivisor(InHz, OutHz);
+  Up = OutHz / Divisor;
+  Down = InHz / Divisor;
+  MaxIn = MaxInput;
+  Phase = 0;
+  Coeffs.Empty();
+  if(!IsActive())
+  {
+    NumTaps = 4;
+    return;
+  }
+
+  //32 taps per phase when upsampling; when downsampling the filter spans proportionally more input samples to keep the same transition band
+  NumTaps = 32 * FMath::DivideAndRoundUp(Down, Up);
+  int32 Length = Up * NumTaps;
+  float Cutoff = 0.9f / (float)FMath::Max(Up, Down); //Relative to the Nyquist frequency at Up times the input rate
+  float Center = 0.5f * (float)(Length - 1);
+  Coeffs.SetNumZeroed(Length);
+  for(int32 p=0; p<Up; ++p)
+  {
+    float* Phased = Coeffs.GetData() + p * NumTaps;
+    float Sum = 0.0f;
+    for(int32 k=0; k<NumTaps; ++k)
+    {
+      //Tap k of phase p delays the input by k samples; stored reversed so the kernel can walk the input forwards
+      int32 m = p + k * Up;
+      float x = Cutoff * ((float)m - Center);
+      float Sinc = FMath::IsNearlyZero(x) ? 1.0f : FMath::Sin(PI * x) / (PI * x);
+      float w = 2.0f * PI * (float)m / (float)(Length - 1);
+      float Window = 0.42f - 0.5f * FMath::Cos(w) + 0.08f * FMath::Cos(2.0f * w);
+      Phased[NumTaps - 1 - k] = Sinc * Window;
+      Sum += Sinc * Window;
+    }
+    //Unity gain at DC for every phase
+    for(int32 k=0; k<NumTaps; ++k) Phased[k] /= Sum;
+  }
+}
+
+int32 FSpace3DUnrealResampler::MaxOutput() const
+{
+  return FMath::DivideAndRoundUp(MaxIn * Up, Down);
+}
+
+int32 FSpace3DUnrealResampler::NumOutputs(int32 NumIn) const
+{
+  if(!IsActive()) return NumIn;
+  int32 Span = NumIn * Up - Phase;
+  return Span > 0 ? FMath::DivideAndRoundUp(Span, Down) : 0;
+}
+
+void FSpace3DUnrealResampler::InitHistory(TArray<float>& History) const
+{
+  History.Empty();
+  History.SetNumZeroed(NumTaps - 1 + MaxIn);
+}
+
+void FSpace3DUnrealResampler::ResetHistory(TArray<float>& History) const
+{
+  FMemory::Memzero(History.GetData(), (NumTaps - 1) * sizeof(float));
+}
+
+int32 FSpace3DUnrealResampler::Process(TArray<float>& History, const float* In, int32 NumIn, float* Out) const
+{
+  check(NumIn <= MaxIn && History.Num() == NumTaps - 1 + MaxIn);
+  if(!IsActive())
+  {
+    FMemory::Memcpy(Out, In, NumIn * sizeof(float));
+    return NumIn;
+  }
+  float* Buffer = History.GetData();
+  FMemory::Memcpy(Buffer + NumTaps - 1, In, NumIn * sizeof(float));
+  int32 NumOut = NumOutputs(NumIn);
+  Space3DUnreal::PolyphaseFilter(Buffer, Coeffs.GetData(), NumTaps, Up, Down, Phase, Out, NumOut);
+  FMemory::Memmove(Buffer, Buffer + NumIn, (NumTaps - 1) * sizeof(float));
+  return NumOut;
+}
+
+void FSpace3DUnrealResampler::Advance(int32 NumIn)
+{
+  if(!IsActive()) return;
+  Phase += NumOutputs(NumIn) * Down - NumIn * Up;
+}
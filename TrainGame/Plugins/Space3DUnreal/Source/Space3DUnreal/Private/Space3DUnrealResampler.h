@@ -0,0 +1,42 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+Rational polyphase resampler, converting blocks of audio from one sample rate to another by Up / Down (the ratio of the rates reduced to lowest terms). The prototype filter is a Blackman-windowed sinc with its cutoff a little below the lower of the two Nyquist frequencies, split into Up phases so that each output sample costs one NumTaps-long dot product (see Space3DUnreal::PolyphaseFilter).
+
+The resampling phase is shared by all channels, so that every channel of a block produces the same number of samples: Process() each channel of a block, then Advance() once. Each channel keeps its own history buffer: the last NumTaps - 1 input samples, followed by room for a block of input.
+
+All storage is allocated in Configure() and InitHistory(), never while running.
+*/
+class FSpace3DUnrealResampler
+{
+public:
+  FSpace3DUnrealResampler();
+
+  /** Sets up conversion from InRate to OutRate, for blocks of up to MaxInput samples, and resets the phase. */
+  void Configure(float InRate, float OutRate, int32 MaxInput);
+
+  /** False if the rates are equal, in which case nothing needs resampling. */
+  bool IsActive() const { return Up != Down; }
+  /** Most samples Process() can produce from MaxInput input samples. */
+  int32 MaxOutput() const;
+  /** Number of samples Process() produces from NumIn input samples at the current phase. */
+  int32 NumOutputs(int32 NumIn) const;
+
+  /** Allocates and clears a channel's history. */
+  void InitHistory(TArray<float>& History) const;
+  /** Clears a channel's history, e.g. when its source stops. */
+  void ResetHistory(TArray<float>& History) const;
+
+  /** Resamples one block of one channel into Out, which must have room for NumOutputs(NumIn) samples. Returns the number of samples written. */
+  int32 Process(TArray<float>& History, const float* In, int32 NumIn, float* Out) const;
+  /** Moves the phase on past a block of NumIn input samples, once all channels of the block have been processed. */
+  void Advance(int32 NumIn);
+
+private:
+  TArray<float> Coeffs;
+  int32 Up, Down, NumTaps, MaxIn;
+  /** Position of the next output sample relative to the next block's first input sample, in units of 1 / Up input samples. */
+  int32 Phase;
+};
@@ -1,28 +1,56 @@
 #include "Space3DUnrealSinks.h"
+#include "Space3DUnrealCommandBuffer.h"
+#include "Space3DUnrealHMDTracker.h"
 #include "Space3D.hpp"
 
+using EObject = FSpace3DUnrealCommandBuffer::EObject;
+using EProp = FSpace3DUnrealCommandBuffer::EProp;
+
 USpace3DUnrealHead::USpace3DUnrealHead(const FObjectInitializer& ObjectInitializer)
   : Super(ObjectInitializer)
   , HRTF(0)
   , OutputChannel(0)
   , TestSound(false)
+  , LateLatchHMDPose(false)
+  , HMDPredictionMs(10.0f)
   {}
   
 void USpace3DUnrealHead::CreateS3DObject()
 {
-  uuid = Space3D::HeadAdd(HRTF, OutputChannel);
+  uint8_t InHRTF = (uint8_t)HRTF;
+  uint32_t InChannel = (uint32_t)OutputChannel;
+  Space3DUnreal::GetCommands().Add(EObject::Head, [InHRTF, InChannel]() { return Space3D::HeadAdd(InHRTF, InChannel); }, MakeOnCreated());
 }
 
 void USpace3DUnrealHead::DestroyS3DObject()
 {
-  Space3D::HeadRemove(uuid);
+  FSpace3DUnrealHMDTracker& Tracker = Space3DUnreal::GetHMDTracker();
+  if(uuid != 0 && Tracker.GetHead() == uuid) Tracker.SetHead(0, 0.0f);
+  if(uuid != 0) Space3DUnreal::GetCommands().Remove(EObject::Head, uuid);
 }
 
 void USpace3DUnrealHead::UpdateS3DProps()
 {
-  Space3D::HeadSetHRTF(uuid, HRTF);
-  Space3D::HeadSetChannel(uuid, OutputChannel);
-  Space3D::HeadTestSound(uuid, TestSound);
+  FSpace3DUnrealCommandBuffer& Commands = Space3DUnreal::GetCommands();
+  Commands.SetProp(uuid, EProp::HeadHRTF, HRTF);
+  Commands.SetProp(uuid, EProp::HeadChannel, OutputChannel);
+  Commands.SetProp(uuid, EProp::HeadTestSound, TestSound);
+  
+  FSpace3DUnrealHMDTracker& Tracker = Space3DUnreal::GetHMDTracker();
+  uint64_t TrackedHead = Tracker.GetHead();
+  if(LateLatchHMDPose && (TrackedHead == 0 || TrackedHead == uuid) && Tracker.UpdateMapping(this))
+  {
+    Tracker.SetHead(uuid, HMDPredictionMs);
+  }
+  else if(TrackedHead == uuid)
+  {
+    Tracker.SetHead(0, 0.0f);
+  }
+}
+
+bool USpace3DUnrealHead::IsPosedExternally() const
+{
+  return Super::IsPosedExternally() || (uuid != 0 && Space3DUnreal::GetHMDTracker().GetHead() == uuid);
 }
 
 USpace3DUnrealMic::USpace3DUnrealMic(const FObjectInitializer& ObjectInitializer)
@@ -33,18 +61,20 @@ USpace3DUnrealMic::USpace3DUnrealMic(const FObjectInitializer& ObjectInitializer
   
 void USpace3DUnrealMic::CreateS3DObject()
 {
-  uuid = Space3D::MicAdd(OutputChannel);
+  uint32_t InChannel = (uint32_t)OutputChannel;
+  Space3DUnreal::GetCommands().Add(EObject::Mic, [InChannel]() { return Space3D::MicAdd(InChannel); }, MakeOnCreated());
 }
 
 void USpace3DUnrealMic::DestroyS3DObject()
 {
-  Space3D::MicRemove(uuid);
+  if(uuid != 0) Space3DUnreal::GetCommands().Remove(EObject::Mic, uuid);
 }
 
 void USpace3DUnrealMic::UpdateS3DProps()
 {
-  Space3D::MicSetChannel(uuid, OutputChannel);
-  Space3D::MicTestSound(uuid, TestSound);
+  FSpace3DUnrealCommandBuffer& Commands = Space3DUnreal::GetCommands();
+  Commands.SetProp(uuid, EProp::MicChannel, OutputChannel);
+  Commands.SetProp(uuid, EProp::MicTestSound, TestSound);
 }
 
 USpace3DUnrealSpeaker::USpace3DUnrealSpeaker(const FObjectInitializer& ObjectInitializer)
@@ -55,18 +85,20 @@ USpace3DUnrealSpeaker::USpace3DUnrealSpeaker(const FObjectInitializer& ObjectIni
   
 void USpace3DUnrealSpeaker::CreateS3DObject()
 {
-  uuid = Space3D::SpeakerAdd(OutputChannel);
+  uint32_t InChannel = (uint32_t)OutputChannel;
+  Space3DUnreal::GetCommands().Add(EObject::Speaker, [InChannel]() { return Space3D::SpeakerAdd(InChannel); }, MakeOnCreated());
 }
 
 void USpace3DUnrealSpeaker::DestroyS3DObject()
 {
-  Space3D::SpeakerRemove(uuid);
+  if(uuid != 0) Space3DUnreal::GetCommands().Remove(EObject::Speaker, uuid);
 }
 
 void USpace3DUnrealSpeaker::UpdateS3DProps()
 {
-  Space3D::SpeakerSetChannel(uuid, OutputChannel);
-  Space3D::SpeakerTestSound(uuid, TestSound);
+  FSpace3DUnrealCommandBuffer& Commands = Space3DUnreal::GetCommands();
+  Commands.SetProp(uuid, EProp::SpeakerChannel, OutputChannel);
+  Commands.SetProp(uuid, EProp::SpeakerTestSound, TestSound);
 }
 
 USpace3DUnrealListener::USpace3DUnrealListener(const FObjectInitializer& ObjectInitializer)
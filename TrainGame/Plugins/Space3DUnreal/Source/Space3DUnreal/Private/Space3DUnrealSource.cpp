@@ -1,5 +1,13 @@
 #include "Space3DUnrealSource.h"
 #include "Space3DUnreal.h"
+#include "Space3DUnrealDSP.h"
+#include "Space3DUnrealRenderWorker.h"
+#include "Space3DUnrealFrameQueue.h"
+#include "Space3DUnrealInputFifo.h"
+#include "Space3DUnrealResampler.h"
+#include "Space3DUnrealDryPath.h"
+#include "Space3DUnrealClock.h"
+#include "Space3DUnrealTrajectories.h"
 
 #include "Space3D.hpp"
 
@@ -64,7 +72,7 @@ bool FSpace3DUnrealSourceFactory::SupportsPlatform(const FString& PlatformName)
   return PlatformName == TEXT("Windows") || PlatformName == TEXT("Linux");
 }
 
-int32 FSpace3DUnrealSourceFactory::GetMaxSupportedChannels() { return 2; }
+int32 FSpace3DUnrealSourceFactory::GetMaxSupportedChannels() { return SPACE3DUNREAL_MAX_SOURCE_CHANNELS; }
 
 TAudioSpatializationPtr FSpace3DUnrealSourceFactory::CreateNewSpatializationPlugin(FAudioDevice* OwningDevice)
 {
@@ -83,6 +91,11 @@ FSpace3DUnrealSource::FSpace3DUnrealSource()
 {
   UE_LOG(LogSpace3DUnreal, Display, TEXT("FSpace3DUnrealSource constructor"));
   NumActiveSources = 0;
+  NextKey = 0;
+  bSourcesLive = false;
+  BufferLength = 0;
+  SampleRate = 48000.0f;
+  InputResampler = MakeUnique<FSpace3DUnrealResampler>();
 }
 FSpace3DUnrealSource::~FSpace3DUnrealSource()
 {
@@ -94,22 +107,68 @@ void FSpace3DUnrealSource::Initialize(const FAudioPluginInitializationParams Ini
   UE_LOG(LogSpace3DUnreal, Display, TEXT("FSpace3DUnrealSource Initialize, %d Hz, up to %d sources, buf len %d"), InitializationParams.SampleRate, InitializationParams.NumSources, InitializationParams.BufferLength);
   check(Space3DUnreal::IsActive());
   
-  uuids.Empty();
-  uuids.AddDefaulted(InitializationParams.NumSources);
+  Keys.Empty();
+  Keys.AddZeroed(InitializationParams.NumSources);
   LastTs.Empty();
   LastTs.AddDefaulted(InitializationParams.NumSources);
+  Staged.Empty();
+  Staged.AddDefaulted(InitializationParams.NumSources);
+  for(int32 i=0; i<Staged.Num(); ++i)
+  {
+    Staged[i].Audio.SetNumZeroed(InitializationParams.BufferLength);
+    Staged[i].T = 0;
+    Staged[i].Downmix = ESpace3DUnrealDownmix::Mid;
+    Staged[i].bPending = false;
+    Staged[i].bSilent = false;
+  }
+  Props.Empty();
+  Props.AddZeroed(InitializationParams.NumSources);
   NumActiveSources = 0;
-  Space3D::GetParams()->fs = (float)InitializationParams.SampleRate;
-  Space3D::SetFrameLength(InitializationParams.BufferLength);
+  BufferLength = InitializationParams.BufferLength;
+  SampleRate = (float)InitializationParams.SampleRate;
+  Space3DUnreal::SetNsPerBuffer((uint64_t)((double)BufferLength * 1000000000.0 / (double)SampleRate));
+  ConfigureRendering();
+}
+
+int32 FSpace3DUnrealSource::GetWantedFrameLength() const
+{
+  int32 FrameLength = Space3DUnreal::GetFrameLengthConfig();
+  return FrameLength > 0 ? FrameLength : BufferLength;
+}
+
+float FSpace3DUnrealSource::GetWantedSampleRate() const
+{
+  int32 Rate = Space3DUnreal::GetInternalSampleRateConfig();
+  return Rate > 0 ? (float)Rate : SampleRate;
+}
+
+void FSpace3DUnrealSource::ConfigureRendering()
+{
+  int32 FrameLength = GetWantedFrameLength();
+  float InternalRate = GetWantedSampleRate();
+  UE_LOG(LogSpace3DUnreal, Display, TEXT("Space3D frame length %d at %f Hz, engine buffer length %d at %f Hz"), FrameLength, InternalRate, BufferLength, SampleRate);
+  Space3DUnreal::StopRenderWorker(); //Frame length may not change while processing
+  Space3D::GetParams()->fs = InternalRate;
+  Space3D::SetFrameLength(FrameLength);
+  InputResampler->Configure(SampleRate, InternalRate, BufferLength);
+  for(int32 i=0; i<Staged.Num(); ++i)
+  {
+    Staged[i].Resampled.Empty();
+    Staged[i].ResamplerHistory.Empty();
+    if(InputResampler->IsActive())
+    {
+      Staged[i].Resampled.SetNumZeroed(InputResampler->MaxOutput());
+      InputResampler->InitHistory(Staged[i].ResamplerHistory);
+    }
+  }
+  Space3DUnreal::ConfigureRendering(Keys.Num(), InputResampler->MaxOutput(), FrameLength, InternalRate, BufferLength, SampleRate);
 }
 void FSpace3DUnrealSource::Shutdown()
 {
   UE_LOG(LogSpace3DUnreal, Display, TEXT("FSpace3DUnrealSource Shutdown"));
   if(!Space3DUnreal::IsActive()) return; //Module de-initialized before spat plugin
-  for(int32 i=0; i<uuids.Num(); ++i)
-  {
-    if(uuids[i] != 0) Space3D::SourceRemove(uuids[i]);
-  }
+  Space3DUnreal::StopRenderWorker();
+  Space3DUnreal::RemoveSources();
 }
 
 void FSpace3DUnrealSource::OnInitSource(const uint32 SourceId, const FName& AudioComponentUserId, USpatializationPluginSourceSettingsBase* InSettings)
@@ -117,36 +176,56 @@ void FSpace3DUnrealSource::OnInitSource(const uint32 SourceId, const FName& Audi
   UE_LOG(LogSpace3DUnreal, Display, TEXT("FSpace3DUnrealSource OnInitSource %d"), SourceId);
   check(Space3DUnreal::IsActive());
   
-  if(uuids[SourceId] != 0)
+  FSourceProps& P = Props[SourceId];
+  if(P.bInUse)
   {
-    Space3D::SourceRemove(uuids[SourceId]);
-    uuids[SourceId] = 0;
     --NumActiveSources;
   }
-  uuids[SourceId] = Space3D::SourceAdd();
-  ++NumActiveSources;
+  P.bInUse = true;
+  P.bHasSettings = InSettings != nullptr;
+  P.SilentSamples = 0;
+  P.TrajectoryUserId = AudioComponentUserId;
   
+  const USpace3DUnrealSourceSettings* Settings = GetDefault<USpace3DUnrealSourceSettings>();
   if(InSettings)
   {
     UE_LOG(LogSpace3DUnreal, Display, TEXT("Source added with spatialization settings."));
-    USpace3DUnrealSourceSettings* Settings = CastChecked<USpace3DUnrealSourceSettings>(InSettings);
-    Space3D::SourceSetVolume(uuids[SourceId], (audiofloat)Settings->Volume);
-    Space3D::SourceSetDir(uuids[SourceId], static_cast<Space3D::DirType>(Settings->DirType), Settings->DirBeamWidth, Settings->DirCosMixFactor, Settings->DirUnused);
-    Space3D::SourceSetThresholds(uuids[SourceId], Settings->ThresholdFull, Settings->ThresholdZero);
+    Settings = CastChecked<USpace3DUnrealSourceSettings>(InSettings);
+    P.Volume = Settings->Volume;
+    P.DirType = Settings->DirType;
+    P.DirBeamWidth = Settings->DirBeamWidth;
+    P.DirCosMixFactor = Settings->DirCosMixFactor;
+    P.DirUnused = Settings->DirUnused;
+    P.ThresholdFull = Settings->ThresholdFull;
+    P.ThresholdZero = Settings->ThresholdZero;
   }
   else
   {
     UE_LOG(LogSpace3DUnreal, Display, TEXT("Source added without spatialization settings."));
   }
+  Staged[SourceId].Downmix = Settings->Downmix;
+  P.bGateSilence = Settings->GateSilence;
+  P.SilenceLevel = FMath::Pow(10.0f, Settings->SilenceThresholdDb / 10.0f);
+  
+  CreateS3DSource(SourceId);
+  ++NumActiveSources;
+}
+
+void FSpace3DUnrealSource::CreateS3DSource(int32 Slot)
+{
+  Keys[Slot] = ++NextKey;
 }
 void FSpace3DUnrealSource::OnReleaseSource(const uint32 SourceId)
 {
   UE_LOG(LogSpace3DUnreal, Display, TEXT("FSpace3DUnrealSource ReleaseSource %d"), SourceId);
   check(Space3DUnreal::IsActive());
-  check(uuids[SourceId] != 0);
-  Space3D::SourceRemove(uuids[SourceId]);
-  uuids[SourceId] = 0;
+  check(Props[SourceId].bInUse);
+  Keys[SourceId] = 0;
+  Props[SourceId].bInUse = false;
   LastTs[SourceId] = 0;
+  Staged[SourceId].bPending = false;
+  //Otherwise the dry fallback keeps playing its last buffer, as nothing stages this slot again
+  Space3DUnreal::GetDryPath().SetSource(SourceId, nullptr, FVector::ZeroVector, 0.0f);
   --NumActiveSources;
 }
 
@@ -155,23 +234,20 @@ void FSpace3DUnrealSource::ProcessAudio(const FAudioPluginSourceInputData& Input
   //Clear output audio
   FMemory::Memset(OutputData.AudioBuffer.GetData(), 0, OutputData.AudioBuffer.Num() * sizeof(float));
   check(Space3DUnreal::IsActive());
-  check(InputData.NumChannels == 1 || InputData.NumChannels == 2);
+  check(InputData.NumChannels >= 1 && InputData.NumChannels <= SPACE3DUNREAL_MAX_SOURCE_CHANNELS);
   check(InputData.AudioBuffer);
   check(NumActiveSources > 0);
-  check(InputData.SourceId >= 0 && InputData.SourceId < uuids.Num());
+  check(InputData.SourceId >= 0 && InputData.SourceId < Keys.Num());
   int spls = InputData.AudioBuffer->Num() / InputData.NumChannels;
-  if(spls != Space3D::FrameLength())
+  if(spls != BufferLength)
   {
-    UE_LOG(LogSpace3DUnreal, Warning, TEXT("Wrong buffer size: input %d Space3D %d. Make sure there is a Space3DUnrealOutput submix effect running."),
-      spls, Space3D::FrameLength());
+    UE_LOG(LogSpace3DUnreal, Warning, TEXT("Wrong buffer size: input %d, initialized for %d."), spls, BufferLength);
     return;
   }
-  //Physics update
+  //Stage physics and audio for this source; everything is submitted to Space3D together in OnAllSourcesProcessed
   const FSpatializationParams* Spat = InputData.SpatializationParams;
-  uint64_t uuid = uuids[InputData.SourceId];
-  check(uuid != 0);
+  check(Props[InputData.SourceId].bInUse);
   uint64_t t = Space3DUnreal::AudioClockToS3DTime(Spat->AudioClock);
-  Space3DUnreal::SetAudioT(t);
   if(t == LastTs[InputData.SourceId])
   {
     //UE_LOG(LogSpace3DUnreal, Warning, TEXT("Source processed again at same time"));
@@ -183,37 +259,156 @@ void FSpace3DUnrealSource::ProcessAudio(const FAudioPluginSourceInputData& Input
   LastTs[InputData.SourceId] = t;
   //UE_LOG(LogSpace3DUnreal, Display, TEXT("Audio clock %f"), Spat->AudioClock);
   
+  FStagedSource& Slot = Staged[InputData.SourceId];
+  check(Slot.Audio.Num() == spls);
+  Slot.T = t;
+  Slot.Position = Spat->EmitterWorldPosition;
+  Slot.Rotation = Spat->EmitterWorldRotation;
+  
+  //Input audio, mixed down to mono directly into the staging buffer
+  float Gain = 1.0f;
+  switch(Slot.Downmix)
+  {
+  case ESpace3DUnrealDownmix::Sum: Gain = 1.0f; break;
+  case ESpace3DUnrealDownmix::Mid: Gain = 1.0f / (float)InputData.NumChannels; break;
+  case ESpace3DUnrealDownmix::EnergyPreserving: Gain = 1.0f / FMath::Sqrt((float)InputData.NumChannels); break;
+  }
+  Space3DUnreal::DownmixToMono(InputData.AudioBuffer->GetData(), Slot.Audio.GetData(), spls, InputData.NumChannels, Gain);
+  const FSourceProps& P = Props[InputData.SourceId];
+  Slot.bSilent = P.bGateSilence && Space3DUnreal::MeanSquare(Slot.Audio.GetData(), spls) < P.SilenceLevel;
+  if(InputResampler->IsActive())
+  {
+    if(Slot.bSilent && Keys[InputData.SourceId] == 0)
+    {
+      //Gated out, so none of this reaches Space3D
+      InputResampler->ResetHistory(Slot.ResamplerHistory);
+    }
+    else
+    {
+      //Every source sees the same resampler phase this buffer; OnAllSourcesProcessed advances it
+      InputResampler->Process(Slot.ResamplerHistory, Slot.Audio.GetData(), spls, Slot.Resampled.GetData());
+    }
+  }
+  Slot.bPending = true;
+}
+
+void FSpace3DUnrealSource::UpdateSilenceGates()
+{
+  //Reflections keep arriving for up to MaxPathDelay frames after the source goes quiet, plus whatever input is still queued for Space3D
+  double HoldSeconds = (double)(Space3D::MaxPathDelay() + 1) * (double)Space3D::FrameLength() / (double)Space3D::GetParams()->fs;
+  int64 HoldSamples = (int64)(HoldSeconds * (double)SampleRate) + BufferLength;
+  for(int32 i=0; i<Props.Num(); ++i)
+  {
+    FSourceProps& P = Props[i];
+    if(!P.bInUse) continue;
+    const FStagedSource& Slot = Staged[i];
+    if(Slot.bPending && !Slot.bSilent)
+    {
+      P.SilentSamples = 0;
+      if(Keys[i] == 0) CreateS3DSource(i);
+      continue;
+    }
+    P.SilentSamples += BufferLength;
+    if(Keys[i] != 0 && P.bGateSilence && P.SilentSamples > HoldSamples)
+    {
+      Keys[i] = 0;
+    }
+  }
+}
+
+void FSpace3DUnrealSource::SubmitStagedSources()
+{
+  UpdateSilenceGates();
+  
+  //Sources riding a trajectory are where it puts them at their own audio time, not where the game last put them
+  FSpace3DUnrealTrajectories& Trajectories = Space3DUnreal::GetTrajectories();
+  for(int32 i=0; i<Staged.Num(); ++i)
+  {
+    FStagedSource& Slot = Staged[i];
+    if(!Slot.bPending || Props[i].TrajectoryUserId.IsNone()) continue;
+    Trajectories.EvalSource(Props[i].TrajectoryUserId, Slot.T, Slot.Position, Slot.Rotation);
+  }
+  
+  //Audio and physics go through the input FIFO, so that Space3D can take the audio in frames of its own length, and the sources are added, removed and moved by whoever runs Space3D
+  FSpace3DUnrealInputFifo& Fifo = Space3DUnreal::GetInputFifo();
+  bool bResampled = InputResampler->IsActive();
+  bool bPush = Fifo.BeginPush(InputResampler->NumOutputs(BufferLength));
   float Scale = Space3DUnreal::GetScaleFactor();
-  glm::vec3 SPos = Scale * U2GV(Spat->EmitterWorldPosition);
-  //glm::vec3 LPos = Scale * U2GV(Spat->ListenerPosition);
-  //UE_LOG(LogSpace3DUnreal, Display, TEXT("Source: %f %f %f | Listener: %f %f %f"), SPos.x, SPos.y, SPos.z, LPos.x, LPos.y, LPos.z);
-  Space3D::PhysUpdate(uuid, t, SPos, U2GQ(Spat->EmitterWorldRotation));
+  bool bLive = false;
+  for(int32 i=0; i<Staged.Num(); ++i)
+  {
+    FStagedSource& Slot = Staged[i];
+    if(bResampled && !Slot.bPending) InputResampler->ResetHistory(Slot.ResamplerHistory);
+    bLive = bLive || Keys[i] != 0;
+    if(!bPush) continue;
+    const FSourceProps& P = Props[i];
+    FSpace3DUnrealSourceState State;
+    State.Key = Keys[i];
+    State.T = Slot.T;
+    State.Position = Scale * Slot.Position;
+    State.Rotation = Slot.Rotation;
+    State.bMoved = Slot.bPending && Keys[i] != 0;
+    State.bHasSettings = P.bHasSettings;
+    State.Volume = P.Volume;
+    State.DirType = P.DirType;
+    State.DirBeamWidth = P.DirBeamWidth;
+    State.DirCosMixFactor = P.DirCosMixFactor;
+    State.DirUnused = P.DirUnused;
+    State.ThresholdFull = P.ThresholdFull;
+    State.ThresholdZero = P.ThresholdZero;
+    const float* Audio = bResampled ? Slot.Resampled.GetData() : Slot.Audio.GetData();
+    Fifo.Write(i, State, State.bMoved ? Audio : nullptr);
+  }
+  InputResampler->Advance(BufferLength);
+  if(bPush) bSourcesLive = bLive;
   
-  //Input audio
-  float *buf;
-  TArray<float> tempBuf;
-  if(InputData.NumChannels == 1)
+  //The dry fallback takes the input at the device rate, straight from staging
+  FSpace3DUnrealDryPath& Dry = Space3DUnreal::GetDryPath();
+  for(int32 i=0; i<Staged.Num(); ++i)
   {
-    buf = InputData.AudioBuffer->GetData();
+    const FStagedSource& Slot = Staged[i];
+    Dry.SetSource(i, Slot.bPending ? Slot.Audio.GetData() : nullptr, Slot.Position, Props[i].bHasSettings ? Props[i].Volume : 1.0f);
   }
-  else
+  Dry.EndBuffer();
+  
+  uint64_t MaxT = 0;
+  for(int32 i=0; i<Staged.Num(); ++i)
+  {
+    FStagedSource& Slot = Staged[i];
+    if(!Slot.bPending) continue;
+    Slot.bPending = false;
+    MaxT = FMath::Max(MaxT, Slot.T);
+  }
+  if(MaxT != 0)
   {
-    //Left channel only
-    tempBuf.SetNum(spls);
-    buf = tempBuf.GetData();
-    const float *inbuf = InputData.AudioBuffer->GetData();
-    for(int i=0; i<spls; ++i) buf[i] = inbuf[InputData.NumChannels*i];
+    Space3DUnreal::SetAudioT(MaxT);
+    Space3DUnreal::GetClock().OnAudioTime(MaxT);
   }
-  Space3D::SourceWrite(uuid, (const audiofloat*)buf);
+  else MaxT = Space3DUnreal::GetAudioT() + Space3DUnreal::GetNsPerBuffer();
+  if(bPush) Fifo.EndPush(MaxT);
+  if(NumActiveSources > 0) Space3DUnreal::GetFrameQueue().ExpectInput();
 }
 
 void FSpace3DUnrealSource::OnAllSourcesProcessed()
 {
   check(Space3DUnreal::IsActive());
-  if(NumActiveSources > 0)
+  if(GetWantedFrameLength() != (int32)Space3D::FrameLength() || GetWantedSampleRate() != Space3D::GetParams()->fs)
+  {
+    ConfigureRendering();
+  }
+  //Carries on a little after the last source is released, until the render side has removed its Space3D sources
+  if(NumActiveSources > 0 || bSourcesLive || Space3DUnreal::GetInputFifo().HasUnappliedPushes())
   {
-    Space3D::Process(Space3DUnreal::GetAudioT());
-    Space3DUnreal::SetOutputAudioAvailable();
+    SubmitStagedSources();
+    FSpace3DUnrealRenderWorker* Worker = Space3DUnreal::UpdateRenderWorker();
+    if(Worker != nullptr)
+    {
+      Worker->Kick();
+    }
+    else
+    {
+      Space3DUnreal::RenderFrames();
+    }
   }
 }
 
@@ -0,0 +1,289 @@
+#include "Space3DUnrealSubsystem.h"
+#include "Async/ParallelFor.h"
+#include "Engine/World.h"
+#include "Space3DUnrealCommandBuffer.h"
+#include "Space3DUnrealClock.h"
+#include "Space3DUnrealPredictor.h"
+#include "Space3DUnrealMeshLoader.h"
+#include "Space3DUnrealSinks.h"
+#include "Camera/PlayerCameraManager.h"
+#include "GameFramework/PlayerController.h"
+#include "Components/PrimitiveComponent.h"
+#include "GameFramework/Actor.h"
+#include "GameFramework/MovementComponent.h"
+
+namespace
+{
+  /** Below this many components, gathering on the game thread is quicker than waking task threads. */
+  constexpr int32 MinParallelGather = 64;
+}
+
+void FSpace3DUnrealTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+  if(Subsystem != nullptr) Subsystem->Tick(DeltaTime);
+}
+
+FString FSpace3DUnrealTickFunction::DiagnosticMessage()
+{
+  return TEXT("FSpace3DUnrealTickFunction");
+}
+
+void USpace3DUnrealSubsystem::Deinitialize()
+{
+  if(TickFunction.IsTickFunctionRegistered()) TickFunction.UnRegisterTickFunction();
+  TickFunction.Subsystem = nullptr;
+  Components.Empty();
+  States.Empty();
+  Sinks.Empty();
+  //Removals recorded as the world's components were unregistered
+  Space3DUnreal::GetPredictor().Commit();
+  Space3DUnreal::GetCommands().Commit();
+  Super::Deinitialize();
+}
+
+void USpace3DUnrealSubsystem::Register(USpace3DUnrealComponent* Component)
+{
+  if(!TickFunction.IsTickFunctionRegistered())
+  {
+    TickFunction.TickGroup = TG_PostPhysics;
+    TickFunction.bCanEverTick = true;
+    TickFunction.bStartWithTickEnabled = true;
+    TickFunction.Subsystem = this;
+    TickFunction.RegisterTickFunction(GetWorld()->PersistentLevel);
+  }
+  check(!Components.Contains(Component));
+  Components.Add(Component);
+  if(Component->IsA<USpace3DUnrealHead>() || Component->IsA<USpace3DUnrealMic>()) Sinks.Add(Component);
+  FTrackState& State = States.AddDefaulted_GetRef();
+  State.bNew = true;
+  State.bMoving = false;
+  State.bPredicted = false;
+  State.SampleT = 0;
+  State.NextT = 0;
+}
+
+void USpace3DUnrealSubsystem::Unregister(USpace3DUnrealComponent* Component)
+{
+  Sinks.RemoveSwap(Component);
+  int32 i = Components.Find(Component);
+  if(i == INDEX_NONE) return;
+  if(States[i].bPredicted) Space3DUnreal::GetPredictor().Remove(Component->uuid);
+  Components.RemoveAtSwap(i);
+  States.RemoveAtSwap(i);
+}
+
+void USpace3DUnrealSubsystem::Tick(float DeltaTime)
+{
+  //Per-component work which may create Space3D objects or upload geometry
+  for(int32 i=Components.Num()-1; i>=0; --i)
+  {
+    USpace3DUnrealComponent* Component = Components[i];
+    Component->PreTick();
+    if(Component->IntentionallyNotCreated)
+    {
+      Components.RemoveAtSwap(i);
+      States.RemoveAtSwap(i);
+    }
+  }
+  //Static meshes whose geometry is ready, a few per frame, so they have a uuid by the time transforms are gathered
+  FSpace3DUnrealMeshLoader& MeshLoader = Space3DUnreal::GetMeshLoader();
+  if(!MeshLoader.IsIdle())
+  {
+    bool bResync;
+    GetListenerLocations(ListenerLocations);
+    MeshLoader.Tick(ListenerLocations, Space3DUnreal::GetClock().Tick(bResync));
+  }
+  FSpace3DUnrealCommandBuffer& Commands = Space3DUnreal::GetCommands();
+  int32 Num = Components.Num();
+  if(Num == 0)
+  {
+    Space3DUnreal::GetPredictor().Commit();
+    Commands.Commit();
+    return;
+  }
+  bool bResync;
+  uint64_t T = Space3DUnreal::GetClock().Tick(bResync);
+
+  //Gather transforms into contiguous arrays, and work out which changed enough to send
+  Uuids.SetNumUninitialized(Num, false);
+  Positions.SetNumUninitialized(Num, false);
+  Rotations.SetNumUninitialized(Num, false);
+  Scales.SetNumUninitialized(Num, false);
+  Actions.SetNumUninitialized(Num, false);
+  float Scale = Space3DUnreal::GetScaleFactor();
+  ParallelFor(Num, [&](int32 i)
+  {
+    const USpace3DUnrealComponent* Component = Components[i];
+    FTrackState& State = States[i];
+    Uuids[i] = Component->uuid;
+    if(Uuids[i] == 0)
+    {
+      //Recorded, but not created until the commands are committed
+      Actions[i] = EAction::None;
+      return;
+    }
+    if(Component->IsPosedExternally())
+    {
+      //Start over when control comes back
+      Actions[i] = EAction::None;
+      State.bNew = true;
+      return;
+    }
+    if(!State.bNew && !bResync && T < State.NextT)
+    {
+      //Not due yet at a reduced update rate; the transform isn't even read
+      Actions[i] = EAction::None;
+      return;
+    }
+    State.NextT = T + (uint64_t)(FMath::Max(Component->MotionUpdateInterval, 0.0f) * 1000000000.0);
+    const FTransform& Transform = Component->GetComponentTransform();
+    Positions[i] = Transform.GetLocation();
+    Rotations[i] = Transform.GetRotation();
+    Scales[i] = Transform.GetScale3D();
+    bool bChanged = State.bNew
+      || FVector::DistSquared(Positions[i], State.Position) > FMath::Square(Component->MotionPositionEpsilon)
+      || FMath::RadiansToDegrees(Rotations[i].AngularDistance(State.Rotation)) > Component->MotionRotationEpsilon
+      || !Scales[i].Equals(State.Scale, Component->MotionScaleEpsilon);
+    if(State.bNew || (bChanged && bResync))
+    {
+      Actions[i] = EAction::Reset;
+      State.bMoving = false;
+    }
+    else if(bChanged && Component->MotionPrediction != ESpace3DUnrealPrediction::None)
+    {
+      //Needs the velocity, which is read on the game thread below
+      Actions[i] = EAction::Predict;
+      State.bMoving = true;
+      return;
+    }
+    else if(bChanged)
+    {
+      Actions[i] = EAction::Update;
+      State.bMoving = true;
+    }
+    else if(State.bMoving)
+    {
+      //Just stopped; pin it where it is
+      Actions[i] = EAction::Reset;
+      State.bMoving = false;
+    }
+    else
+    {
+      Actions[i] = EAction::None;
+      return;
+    }
+    State.bNew = false;
+    State.Position = Positions[i];
+    State.Rotation = Rotations[i];
+    State.Scale = Scales[i];
+    State.SampleT = T;
+    Positions[i] *= Scale;
+    if(Component->RequiresScaleScale()) Scales[i] *= Scale;
+  }, Num < MinParallelGather);
+
+  //Record transforms and properties, then commit them along with everything else recorded this frame, in one atomic section
+  FSpace3DUnrealPredictor& Predictor = Space3DUnreal::GetPredictor();
+  for(int32 i=0; i<Num; ++i)
+  {
+    if(Uuids[i] == 0) continue;
+    USpace3DUnrealComponent* Component = Components[i];
+    FTrackState& State = States[i];
+    if(Actions[i] == EAction::Predict)
+    {
+      Predict(Component, State, T, Positions[i], Rotations[i], Scales[i]);
+    }
+    else
+    {
+      if(Actions[i] != EAction::None)
+      {
+        Commands.SetTransform(Uuids[i], T, Positions[i], Rotations[i], Scales[i], Actions[i] == EAction::Reset);
+      }
+      if(State.bPredicted && (Actions[i] != EAction::None || State.bNew))
+      {
+        Predictor.Remove(Uuids[i]);
+        State.bPredicted = false;
+      }
+    }
+    Component->UpdateS3DProps();
+  }
+  Predictor.Commit();
+  Commands.Commit();
+
+  //Static components are done once they are in Space3D
+  for(int32 i=Num-1; i>=0; --i)
+  {
+    if(Uuids[i] != 0 && Components[i]->IsStaticAfterBeginPlay())
+    {
+      Components.RemoveAtSwap(i);
+      States.RemoveAtSwap(i);
+    }
+  }
+}
+
+void USpace3DUnrealSubsystem::GetListenerLocations(TArray<FVector>& OutLocations) const
+{
+  OutLocations.Reset();
+  for(const USpace3DUnrealComponent* Sink : Sinks) OutLocations.Add(Sink->GetComponentLocation());
+  if(OutLocations.Num() > 0) return;
+  APlayerController* Player = GetWorld()->GetFirstPlayerController();
+  OutLocations.Add(Player != nullptr && Player->PlayerCameraManager != nullptr ? Player->PlayerCameraManager->GetCameraLocation() : FVector::ZeroVector);
+}
+
+void USpace3DUnrealSubsystem::Predict(USpace3DUnrealComponent* Component, FTrackState& State, uint64_t T, const FVector& Position, const FQuat& Rotation, const FVector& Scale3D)
+{
+  //Fall back on the motion since the last update, for anything moved without a velocity (animation, SetActorLocation, etc.)
+  double dt = T > State.SampleT ? (double)(T - State.SampleT) * 1.0e-9 : 0.0;
+  FVector Velocity = FVector::ZeroVector;
+  FVector AngularVelocity = FVector::ZeroVector;
+  if(dt > 0.0)
+  {
+    Velocity = (Position - State.Position) / dt;
+    FQuat Delta = Rotation * State.Rotation.Inverse();
+    if(Delta.W < 0.0f) Delta = FQuat(-Delta.X, -Delta.Y, -Delta.Z, -Delta.W);
+    FVector Axis;
+    float Angle;
+    Delta.ToAxisAndAngle(Axis, Angle);
+    AngularVelocity = Axis * (float)(Angle / dt);
+  }
+  //Prefer the physics body carrying the component, then the actor's movement component
+  bool bFromBody = false;
+  for(USceneComponent* Parent = Component; Parent != nullptr && !bFromBody; Parent = Parent->GetAttachParent())
+  {
+    UPrimitiveComponent* Body = Cast<UPrimitiveComponent>(Parent);
+    if(Body == nullptr || !Body->IsSimulatingPhysics()) continue;
+    Velocity = Body->GetPhysicsLinearVelocityAtPoint(Position);
+    AngularVelocity = Body->GetPhysicsAngularVelocityInRadians();
+    bFromBody = true;
+  }
+  AActor* Owner = Component->GetOwner();
+  UMovementComponent* Movement = Owner != nullptr && !bFromBody ? Owner->FindComponentByClass<UMovementComponent>() : nullptr;
+  if(Movement != nullptr && Movement->UpdatedComponent != nullptr && (Movement->UpdatedComponent == Component || Component->IsAttachedTo(Movement->UpdatedComponent)))
+  {
+    Velocity = Movement->Velocity;
+  }
+  FVector Acceleration = FVector::ZeroVector;
+  if(Component->MotionPrediction == ESpace3DUnrealPrediction::ConstantAcceleration && State.bPredicted && dt > 0.0)
+  {
+    Acceleration = (Velocity - State.Velocity) / dt;
+  }
+
+  State.bNew = false;
+  State.bPredicted = true;
+  State.Position = Position;
+  State.Rotation = Rotation;
+  State.Scale = Scale3D;
+  State.Velocity = Velocity;
+  State.SampleT = T;
+
+  float Scale = Space3DUnreal::GetScaleFactor();
+  FSpace3DUnrealPredictor::FSample Sample;
+  Sample.uuid = Component->uuid;
+  Sample.T = T;
+  Sample.Position = Position * Scale;
+  Sample.Rotation = Rotation;
+  Sample.Scale = Component->RequiresScaleScale() ? Scale3D * Scale : Scale3D;
+  Sample.Velocity = Velocity * Scale;
+  Sample.AngularVelocity = AngularVelocity;
+  Sample.Acceleration = Acceleration * Scale;
+  Space3DUnreal::GetPredictor().Set(Sample);
+}
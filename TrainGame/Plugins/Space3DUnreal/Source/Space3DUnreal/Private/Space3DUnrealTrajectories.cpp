@@ -0,0 +1,162 @@
+#include "Space3DUnrealTrajectories.h"
+#include "Space3DUnreal.h"
+
+#include "Space3D.hpp"
+
+FSpace3DUnrealTrajectories::FPath::FPath(const USplineComponent& Spline)
+  : Curves(Spline.SplineCurves)
+  , ToWorld(Spline.GetComponentTransform())
+  , DefaultUp(Spline.DefaultUpVector)
+  , Length(Spline.GetSplineLength())
+  , bLoop(Spline.IsClosedLoop())
+{}
+
+FTransform FSpace3DUnrealTrajectories::FPath::Eval(double Distance) const
+{
+  if(bLoop && Length > 0.0f)
+  {
+    Distance -= FMath::FloorToDouble(Distance / Length) * Length;
+  }
+  else
+  {
+    Distance = FMath::Clamp(Distance, 0.0, (double)Length);
+  }
+  //As USplineComponent::GetTransformAtSplineInputKey, without scale
+  float Key = Curves.ReparamTable.Eval((float)Distance, 0.0f);
+  FVector Position = Curves.Position.Eval(Key, FVector::ZeroVector);
+  FQuat Quat = Curves.Rotation.Eval(Key, FQuat::Identity);
+  Quat.Normalize();
+  FVector Direction = Curves.Position.EvalDerivative(Key, FVector::ZeroVector).GetSafeNormal();
+  FQuat Rotation = FRotationMatrix::MakeFromXZ(Direction, Quat.RotateVector(DefaultUp)).ToQuat();
+  FTransform World = FTransform(Rotation, Position) * ToWorld;
+  World.SetScale3D(FVector::OneVector);
+  return World;
+}
+
+double FSpace3DUnrealTrajectories::FMotion::DistanceAt(uint64_t T) const
+{
+  double dt = T >= T0 ? (double)(T - T0) * 1.0e-9 : -(double)(T0 - T) * 1.0e-9;
+  if(Acceleration <= 0.0 || Speed == TargetSpeed) return Distance + Speed * dt;
+  double a = TargetSpeed > Speed ? Acceleration : -Acceleration;
+  double ta = (TargetSpeed - Speed) / a;
+  if(dt < ta) return Distance + (Speed + 0.5 * a * dt) * dt;
+  return Distance + (Speed + 0.5 * a * ta) * ta + TargetSpeed * (dt - ta);
+}
+
+double FSpace3DUnrealTrajectories::FMotion::SpeedAt(uint64_t T) const
+{
+  double dt = T >= T0 ? (double)(T - T0) * 1.0e-9 : -(double)(T0 - T) * 1.0e-9;
+  if(Acceleration <= 0.0 || Speed == TargetSpeed) return Speed;
+  double a = TargetSpeed > Speed ? Acceleration : -Acceleration;
+  double ta = (TargetSpeed - Speed) / a;
+  return dt < ta ? Speed + a * dt : TargetSpeed;
+}
+
+FSpace3DUnrealTrajectories::FSpace3DUnrealTrajectories() : NextHandle(1) {}
+
+int32 FSpace3DUnrealTrajectories::Add(TSharedPtr<const FPath, ESPMode::ThreadSafe> Path, const FMotion& Motion)
+{
+  FScopeLock ScopeLock(&Lock);
+  int32 Handle = NextHandle++;
+  Trajectories.Add(Handle, FTrajectory{MoveTemp(Path), Motion});
+  return Handle;
+}
+
+void FSpace3DUnrealTrajectories::SetPath(int32 Handle, TSharedPtr<const FPath, ESPMode::ThreadSafe> Path)
+{
+  FScopeLock ScopeLock(&Lock);
+  FTrajectory* Trajectory = Trajectories.Find(Handle);
+  if(Trajectory != nullptr) Trajectory->Path = MoveTemp(Path);
+}
+
+void FSpace3DUnrealTrajectories::SetMotion(int32 Handle, const FMotion& Motion)
+{
+  FScopeLock ScopeLock(&Lock);
+  FTrajectory* Trajectory = Trajectories.Find(Handle);
+  if(Trajectory != nullptr) Trajectory->Motion = Motion;
+}
+
+void FSpace3DUnrealTrajectories::Remove(int32 Handle)
+{
+  FScopeLock ScopeLock(&Lock);
+  Trajectories.Remove(Handle);
+  Objects.RemoveAll([Handle](const FObjectBinding& B) { return B.Handle == Handle; });
+  for(auto It = Sources.CreateIterator(); It; ++It)
+  {
+    if(It.Value().Handle == Handle) It.RemoveCurrent();
+  }
+}
+
+void FSpace3DUnrealTrajectories::BindObject(int32 Handle, uint64_t uuid, const FTransform& Offset, bool bScaleScale)
+{
+  FScopeLock ScopeLock(&Lock);
+  Objects.RemoveAll([uuid](const FObjectBinding& B) { return B.uuid == uuid; });
+  //Kept sorted by trajectory, so each is evaluated once per frame
+  int32 i = 0;
+  while(i < Objects.Num() && Objects[i].Handle <= Handle) ++i;
+  Objects.Insert(FObjectBinding{Handle, uuid, Offset, bScaleScale}, i);
+}
+
+void FSpace3DUnrealTrajectories::UnbindObject(uint64_t uuid)
+{
+  FScopeLock ScopeLock(&Lock);
+  Objects.RemoveAll([uuid](const FObjectBinding& B) { return B.uuid == uuid; });
+}
+
+void FSpace3DUnrealTrajectories::BindSource(int32 Handle, FName UserId, const FTransform& Offset)
+{
+  FScopeLock ScopeLock(&Lock);
+  Sources.Add(UserId, FSourceBinding{Handle, Offset});
+}
+
+void FSpace3DUnrealTrajectories::UnbindSource(FName UserId)
+{
+  FScopeLock ScopeLock(&Lock);
+  Sources.Remove(UserId);
+}
+
+void FSpace3DUnrealTrajectories::ApplyToObjects(uint64_t T)
+{
+  FScopeLock ScopeLock(&Lock);
+  float Scale = Space3DUnreal::GetScaleFactor();
+  int32 LastHandle = 0;
+  const FTrajectory* Trajectory = nullptr;
+  FTransform Frame;
+  for(const FObjectBinding& B : Objects)
+  {
+    if(B.Handle != LastHandle)
+    {
+      LastHandle = B.Handle;
+      Trajectory = Trajectories.Find(B.Handle);
+      if(Trajectory != nullptr && Trajectory->Path.IsValid()) Frame = Trajectory->Path->Eval(Trajectory->Motion.DistanceAt(T));
+    }
+    if(Trajectory == nullptr || !Trajectory->Path.IsValid()) continue;
+    FTransform World = B.Offset * Frame;
+    FVector Position = World.GetLocation() * Scale;
+    FQuat Rotation = World.GetRotation();
+    FVector Scale3D = B.bScaleScale ? World.GetScale3D() * Scale : World.GetScale3D();
+    Space3D::PhysReset(B.uuid, T, U2GV(Position), U2GQ(Rotation), U2GV(Scale3D));
+  }
+}
+
+bool FSpace3DUnrealTrajectories::Eval(int32 Handle, uint64_t T, FTransform& OutFrame)
+{
+  FScopeLock ScopeLock(&Lock);
+  const FTrajectory* Trajectory = Trajectories.Find(Handle);
+  if(Trajectory == nullptr || !Trajectory->Path.IsValid()) return false;
+  OutFrame = Trajectory->Path->Eval(Trajectory->Motion.DistanceAt(T));
+  return true;
+}
+
+bool FSpace3DUnrealTrajectories::EvalSource(FName UserId, uint64_t T, FVector& OutPosition, FQuat& OutRotation)
+{
+  FScopeLock ScopeLock(&Lock);
+  const FSourceBinding* B = Sources.Find(UserId);
+  if(B == nullptr) return false;
+  const FTrajectory* Trajectory = Trajectories.Find(B->Handle);
+  if(Trajectory == nullptr || !Trajectory->Path.IsValid()) return false;
+  FTransform World = B->Offset * Trajectory->Path->Eval(Trajectory->Motion.DistanceAt(T));
+  OutPosition = World.GetLocation();
+  OutRotation = World.GetRotation();
+  return true;
+}
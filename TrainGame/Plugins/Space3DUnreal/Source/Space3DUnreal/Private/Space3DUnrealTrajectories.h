@@ -0,0 +1,93 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/SplineComponent.h"
+#include "HAL/CriticalSection.h"
+
+/**
+Objects moving along known paths, posed on the audio side at the exact time of each Space3D frame instead of from game-thread updates.
+
+Each trajectory is a spline (copied, so it can be evaluated off the game thread) and a motion profile along it: a distance and speed at some time, and a constant acceleration towards a target speed. Space3D objects (meshes, sinks) bound to a trajectory are PhysReset from Space3D's physics callback, at the as_of_time of each Process call. Engine audio sources bound to it, identified by their audio component's AudioComponentUserID, have the position the audio engine reports for them replaced by the trajectory's, at the time of each buffer. In both cases the object sits at a fixed offset from the trajectory's frame.
+
+The game thread adds, changes and removes trajectories and bindings; the audio thread reads them. Both take a lock, which the game thread only holds for small edits.
+*/
+class FSpace3DUnrealTrajectories
+{
+public:
+  /** A spline, in the world. Immutable once created. */
+  struct FPath
+  {
+    FSplineCurves Curves;
+    FTransform ToWorld;
+    FVector DefaultUp;
+    float Length;
+    bool bLoop;
+
+    /** Copies the spline's curves and current world transform. */
+    explicit FPath(const USplineComponent& Spline);
+    /** Location and rotation (no scale) of the point Distance along the spline, like USplineComponent::GetTransformAtDistanceAlongSpline in world space. Wraps around closed loops and clamps at the ends of open splines. */
+    FTransform Eval(double Distance) const;
+  };
+
+  /** Distance along the path (in Unreal units) as a function of Space3D time. */
+  struct FMotion
+  {
+    /** Distance and speed at time T0. */
+    double Distance, Speed;
+    /** Speed approached at Acceleration (>= 0), and kept thereafter. */
+    double TargetSpeed, Acceleration;
+    uint64_t T0;
+
+    double DistanceAt(uint64_t T) const;
+    double SpeedAt(uint64_t T) const;
+  };
+
+  FSpace3DUnrealTrajectories();
+
+  /** Game thread. Returns a handle for the other calls. */
+  int32 Add(TSharedPtr<const FPath, ESPMode::ThreadSafe> Path, const FMotion& Motion);
+  void SetPath(int32 Handle, TSharedPtr<const FPath, ESPMode::ThreadSafe> Path);
+  void SetMotion(int32 Handle, const FMotion& Motion);
+  /** Also unbinds everything bound to it. */
+  void Remove(int32 Handle);
+
+  /** Game thread. Offset is the object's transform relative to the trajectory's frame; its position and scale are converted to Space3D units (scale only if bScaleScale) when it is posed. */
+  void BindObject(int32 Handle, uint64_t uuid, const FTransform& Offset, bool bScaleScale);
+  void UnbindObject(uint64_t uuid);
+  void BindSource(int32 Handle, FName UserId, const FTransform& Offset);
+  void UnbindSource(FName UserId);
+
+  /** Any thread: the frame of the trajectory at T, or false if there is no such trajectory. */
+  bool Eval(int32 Handle, uint64_t T, FTransform& OutFrame);
+  /** Audio thread, from the Space3D physics callback: PhysResets every bound object to where it is at T. */
+  void ApplyToObjects(uint64_t T);
+  /** Audio thread: if the source with this audio component user ID is bound, sets where it is at T (Unreal units) and returns true. */
+  bool EvalSource(FName UserId, uint64_t T, FVector& OutPosition, FQuat& OutRotation);
+
+private:
+  struct FTrajectory
+  {
+    TSharedPtr<const FPath, ESPMode::ThreadSafe> Path;
+    FMotion Motion;
+  };
+
+  struct FObjectBinding
+  {
+    int32 Handle;
+    uint64_t uuid;
+    FTransform Offset;
+    bool bScaleScale;
+  };
+
+  struct FSourceBinding
+  {
+    int32 Handle;
+    FTransform Offset;
+  };
+
+  FCriticalSection Lock;
+  TMap<int32, FTrajectory> Trajectories;
+  TArray<FObjectBinding> Objects;
+  TMap<FName, FSourceBinding> Sources;
+  int32 NextHandle;
+};
@@ -0,0 +1,189 @@
+#include "Space3DUnrealTrajectory.h"
+#include "Space3DUnrealTrajectories.h"
+#include "Space3DUnrealClock.h"
+#include "Components/AudioComponent.h"
+#include "Components/SplineComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+
+namespace
+{
+  FSpace3DUnrealTrajectories::FMotion MakeMotion(double Distance, double Speed, double TargetSpeed, double Acceleration, uint64_t T0)
+  {
+    FSpace3DUnrealTrajectories::FMotion Motion;
+    Motion.Distance = Distance;
+    Motion.Speed = Speed;
+    Motion.TargetSpeed = TargetSpeed;
+    Motion.Acceleration = Acceleration;
+    Motion.T0 = T0;
+    return Motion;
+  }
+}
+
+USpace3DUnrealSplineTrajectory::USpace3DUnrealSplineTrajectory(const FObjectInitializer& ObjectInitializer)
+  : Super(ObjectInitializer)
+  , SplineActor(nullptr)
+  , StartDistance(0.0f)
+  , StartSpeed(0.0f)
+  , TargetSpeed(0.0f)
+  , Acceleration(0.0f)
+  , DriveOwner(true)
+  , Handle(0)
+  , Distance0(0.0)
+  , Speed0(0.0)
+  , TargetSpeed0(0.0)
+  , Acceleration0(0.0)
+  , T0(0)
+{
+  PrimaryComponentTick.bCanEverTick = true;
+  PrimaryComponentTick.TickGroup = TG_PrePhysics;
+}
+
+uint64_t USpace3DUnrealSplineTrajectory::Now()
+{
+  bool bResync;
+  return Space3DUnreal::GetClock().Tick(bResync);
+}
+
+USplineComponent* USpace3DUnrealSplineTrajectory::FindSpline() const
+{
+  return SplineActor != nullptr ? SplineActor->FindComponentByClass<USplineComponent>() : nullptr;
+}
+
+FTransform USpace3DUnrealSplineTrajectory::GetOffset(const USceneComponent* Component) const
+{
+  const AActor* Owner = GetOwner();
+  return Component->GetComponentTransform().GetRelativeTransform(FTransform(Owner->GetActorQuat(), Owner->GetActorLocation()));
+}
+
+void USpace3DUnrealSplineTrajectory::OnRegister()
+{
+  Super::OnRegister();
+  //Sounds keep the user ID they started with, and auto-activated ones start in InitializeComponents, before BeginPlay
+  UWorld* World = GetWorld();
+  if(World == nullptr || !World->IsGameWorld()) return;
+  TInlineComponentArray<UAudioComponent*> AudioComponents(GetOwner());
+  for(UAudioComponent* Audio : AudioComponents) AssignUserID(Audio);
+}
+
+bool USpace3DUnrealSplineTrajectory::AssignUserID(UAudioComponent* Audio) const
+{
+  if(!Audio->AudioComponentUserID.IsNone()) return false;
+  Audio->AudioComponentUserID = FName(*FString::Printf(TEXT("%s.%s"), *GetOwner()->GetPathName(), *Audio->GetName()));
+  return true;
+}
+
+void USpace3DUnrealSplineTrajectory::BeginPlay()
+{
+  Super::BeginPlay();
+  Distance0 = StartDistance;
+  Speed0 = StartSpeed;
+  TargetSpeed0 = TargetSpeed;
+  Acceleration0 = Acceleration;
+  T0 = Now();
+  Register();
+}
+
+bool USpace3DUnrealSplineTrajectory::Register()
+{
+  if(!Space3DUnreal::IsActive()) return false;
+  USplineComponent* Spline = FindSpline();
+  if(Spline == nullptr)
+  {
+    UE_LOG(LogSpace3DUnreal, Warning, TEXT("%s: no spline to follow"), *GetOwner()->GetName());
+    return false;
+  }
+  Handle = Space3DUnreal::GetTrajectories().Add(MakeShared<const FSpace3DUnrealTrajectories::FPath, ESPMode::ThreadSafe>(*Spline), MakeMotion(Distance0, Speed0, TargetSpeed0, Acceleration0, T0));
+  Follow();
+  return true;
+}
+
+void USpace3DUnrealSplineTrajectory::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+  if(Handle != 0)
+  {
+    //Back to being updated by the subsystem
+    TInlineComponentArray<USpace3DUnrealComponent*> Components(GetOwner());
+    for(USpace3DUnrealComponent* Component : Components) Component->bPosedByTrajectory = false;
+    Space3DUnreal::GetTrajectories().Remove(Handle);
+    Handle = 0;
+    BoundSources.Empty();
+  }
+  Super::EndPlay(EndPlayReason);
+}
+
+void USpace3DUnrealSplineTrajectory::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+  Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+  if(Handle != 0) Follow();
+}
+
+void USpace3DUnrealSplineTrajectory::Follow()
+{
+  //The actor is put on the trajectory before anything is bound relative to it
+  FTransform Frame;
+  if(DriveOwner && Space3DUnreal::GetTrajectories().Eval(Handle, Now(), Frame))
+  {
+    GetOwner()->SetActorLocationAndRotation(Frame.GetLocation(), Frame.GetRotation());
+  }
+  BindComponents();
+}
+
+void USpace3DUnrealSplineTrajectory::BindComponents()
+{
+  FSpace3DUnrealTrajectories& Trajectories = Space3DUnreal::GetTrajectories();
+  AActor* Owner = GetOwner();
+
+  //Space3D objects have a uuid once the frame's commands which create them are committed
+  TInlineComponentArray<USpace3DUnrealComponent*> Components(Owner);
+  for(USpace3DUnrealComponent* Component : Components)
+  {
+    if(Component->uuid == 0 || Component->IsPosedExternally()) continue;
+    Trajectories.BindObject(Handle, Component->uuid, GetOffset(Component), Component->RequiresScaleScale());
+    Component->bPosedByTrajectory = true;
+  }
+
+  //Sounds only follow the trajectory if they were started with the user ID, so one added since OnRegister and already playing is started again
+  TInlineComponentArray<UAudioComponent*> AudioComponents(Owner);
+  for(UAudioComponent* Audio : AudioComponents)
+  {
+    if(AssignUserID(Audio) && Audio->IsPlaying()) Audio->Play();
+    if(BoundSources.Contains(Audio->AudioComponentUserID)) continue;
+    Trajectories.BindSource(Handle, Audio->AudioComponentUserID, GetOffset(Audio));
+    BoundSources.Add(Audio->AudioComponentUserID);
+  }
+}
+
+void USpace3DUnrealSplineTrajectory::SetSpline(AActor* NewSplineActor)
+{
+  SplineActor = NewSplineActor;
+  if(!HasBegunPlay()) return;
+  if(Handle == 0)
+  {
+    Register();
+    return;
+  }
+  USplineComponent* Spline = FindSpline();
+  if(Spline == nullptr) return;
+  Space3DUnreal::GetTrajectories().SetPath(Handle, MakeShared<const FSpace3DUnrealTrajectories::FPath, ESPMode::ThreadSafe>(*Spline));
+}
+
+void USpace3DUnrealSplineTrajectory::SetMotion(float Distance, float Speed, float NewTargetSpeed, float NewAcceleration)
+{
+  Distance0 = Distance;
+  Speed0 = Speed;
+  TargetSpeed0 = NewTargetSpeed;
+  Acceleration0 = FMath::Max(NewAcceleration, 0.0f);
+  T0 = Now();
+  if(Handle != 0) Space3DUnreal::GetTrajectories().SetMotion(Handle, MakeMotion(Distance0, Speed0, TargetSpeed0, Acceleration0, T0));
+}
+
+float USpace3DUnrealSplineTrajectory::GetDistance() const
+{
+  return (float)MakeMotion(Distance0, Speed0, TargetSpeed0, Acceleration0, T0).DistanceAt(Now());
+}
+
+float USpace3DUnrealSplineTrajectory::GetSpeed() const
+{
+  return (float)MakeMotion(Distance0, Speed0, TargetSpeed0, Acceleration0, T0).SpeedAt(Now());
+}
@@ -15,6 +15,18 @@
 
 DECLARE_LOG_CATEGORY_EXTERN(LogSpace3DUnreal, Log, All);
 
+class FSpace3DUnrealRenderWorker;
+class FSpace3DUnrealFrameQueue;
+class FSpace3DUnrealInputFifo;
+class FSpace3DUnrealGovernor;
+class FSpace3DUnrealDryPath;
+class FSpace3DUnrealCommandBuffer;
+class FSpace3DUnrealHMDTracker;
+class FSpace3DUnrealClock;
+class FSpace3DUnrealTrajectories;
+class FSpace3DUnrealPredictor;
+class FSpace3DUnrealMeshLoader;
+
 class FSpace3DUnrealModule : public IModuleInterface
 {
 public:
@@ -35,11 +47,63 @@ namespace Space3DUnreal {
   float GetScaleFactor();
   void SetScaleFactor(float Scale);
   
-  void SetOutputAudioAvailable();
-  uint32_t GetAndConsumeOutputAudio();
-  
   void SetAudioT(uint64_t t);
   uint64_t GetAudioT();
+  /** Smoothed mapping of game frames onto the audio clock, for component physics updates. */
+  FSpace3DUnrealClock& GetClock();
+  /** Length of one engine audio buffer in ns, i.e. how often the audio time advances. */
+  void SetNsPerBuffer(uint64_t Ns);
+  uint64_t GetNsPerBuffer();
+  
+  /** Space3D frame length requested by the output preset; 0 = the engine's buffer size. */
+  void SetFrameLengthConfig(int32 FrameLength);
+  int32 GetFrameLengthConfig();
+  /** Sample rate Space3D renders at, requested by the output preset; 0 = the device rate. */
+  void SetInternalSampleRateConfig(int32 SampleRate);
+  int32 GetInternalSampleRateConfig();
+  
+  /** Sizes the input FIFO, frame queue and output resampler for Space3D running at FrameLength / InternalRate, with the engine at BufferLength / DeviceRate. MaxPushLength is the most input samples pushed per engine buffer. Removes the sources' Space3D sources, which the next push adds again. Must not be called while Space3D is processing. */
+  void ConfigureRendering(int32 NumSlots, int32 MaxPushLength, int32 FrameLength, float InternalRate, int32 BufferLength, float DeviceRate);
+  
+  /** Removes the Space3D sources added for the spatializer's slots from the input FIFO. Must not be called while Space3D is processing. */
+  void RemoveSources();
+  
+  /** Source input on its way from the spatializer to Space3D, rebuffered to Space3D's frame length. */
+  FSpace3DUnrealInputFifo& GetInputFifo();
+  /** Rendered frames on their way from Space3D::Process to the output submix. */
+  FSpace3DUnrealFrameQueue& GetFrameQueue();
+  /** Scales Space3D's quality with how long Space3D::Process takes, fed by ProcessFrame. */
+  FSpace3DUnrealGovernor& GetGovernor();
+  /** Direct-path-only stand-in for Space3D's output while it is stalled. */
+  FSpace3DUnrealDryPath& GetDryPath();
+  /** Scene changes recorded by components, committed once per game frame by USpace3DUnrealSubsystem. */
+  FSpace3DUnrealCommandBuffer& GetCommands();
+  /** Poses the late-latched head sink, if any, from the HMD on the audio thread. */
+  FSpace3DUnrealHMDTracker& GetHMDTracker();
+  /** as_of_time of the Space3D::Process call now running, or of the last one, for Space3D's physics callback. */
+  uint64_t GetProcessT();
+  /** Objects and sources moving along splines, posed at audio rate from Space3D's physics callback. */
+  FSpace3DUnrealTrajectories& GetTrajectories();
+  /** Moving objects extrapolated from their velocity at audio rate, from Space3D's physics callback. */
+  FSpace3DUnrealPredictor& GetPredictor();
+  /** Static meshes being extracted in the background and uploaded a few per game frame by USpace3DUnrealSubsystem. */
+  FSpace3DUnrealMeshLoader& GetMeshLoader();
+  /** How long the Space3D::Process call now running has taken, in frame lengths (0 when none is running). Any thread. */
+  float GetProcessInFlightFrames();
+  /** Runs Space3D::Process as of time T, timing it for the governor, and publishes the output, resampled to the device rate if need be, to the frame queue as frame Seq. */
+  void ProcessFrame(uint64_t Seq, uint64_t T);
+  /** Applies the source states pushed to the input FIFO, writes each full frame waiting there to Space3D and processes it. Called by whoever runs Space3D: the audio render thread, or the render worker. */
+  void RenderFrames();
+  /** Number of channels the output submix plays. Only these are read back from Space3D after processing (0 = all). */
+  void SetNumOutputChannelsPlayed(int32 NumChannels);
+  
+  /** Whether Space3D::Process runs on the render worker (see FSpace3DUnrealRenderWorker), and how many frames may be buffered ahead of the output, set from the output preset. */
+  void SetRenderWorkerConfig(bool bEnable, int32 NumBuffers);
+  /** Audio render thread only: starts or stops the render worker to match the configuration. Returns the running worker, or nullptr when processing synchronously. */
+  FSpace3DUnrealRenderWorker* UpdateRenderWorker();
+  /** Audio render thread only: the running render worker, or nullptr when processing synchronously. */
+  FSpace3DUnrealRenderWorker* GetRenderWorker();
+  void StopRenderWorker();
   
   inline uint64_t AudioClockToS3DTime(double AudioClock){
     return (uint64_t)(AudioClock * 1000000000.0);
@@ -56,13 +120,61 @@ namespace Space3DUnreal {
 #define U2GV(fvec) glm::vec3(fvec.X, fvec.Y, fvec.Z)
 
 
-/** Abstract base class for Space3D physics stuff. */
+/** How a Space3D component's transform is kept up to date. */
+UENUM(BlueprintType)
+enum class ESpace3DUnrealMotion : uint8
+{
+  /** StaticAfterBeginPlay if this component, or the one it is attached to (e.g. a wall's static mesh), has Static mobility; otherwise Movable. */
+  Auto,
+  /** The transform is sent to Space3D whenever it changes by more than the motion epsilons. */
+  Movable,
+  /** The transform and properties are sent to Space3D once, after which the component is no longer updated at all. */
+  StaticAfterBeginPlay
+};
+
+/** How a moving Space3D component's motion is filled in between the updates sent to Space3D. */
+UENUM(BlueprintType)
+enum class ESpace3DUnrealPrediction : uint8
+{
+  /** Space3D interpolates and extrapolates from the last few transforms it was sent. */
+  None,
+  /** Each update also carries the object's velocity, from the physics body or movement component moving it (or else from its motion since the last update), and the object is extrapolated at that velocity on the audio side, at the time of each audio frame. */
+  ConstantVelocity,
+  /** As ConstantVelocity, plus the change in velocity since the last update. */
+  ConstantAcceleration
+};
+
+/** Abstract base class for Space3D physics stuff. Components don't tick on their own; their world's USpace3DUnrealSubsystem updates all of them in one pass each frame. */
 UCLASS(Abstract, BlueprintType)
 class SPACE3DUNREAL_API USpace3DUnrealComponent : public USceneComponent
 {
   GENERATED_BODY()
   
 public:
+  /** Whether this object moves after it is spawned. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Motion)
+  ESpace3DUnrealMotion Motion;
+  
+  /** Changes in position smaller than this (in Unreal units) since the last update sent to Space3D are ignored. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Motion, meta = (ClampMin = "0.0"))
+  float MotionPositionEpsilon;
+  
+  /** Changes in rotation smaller than this (in degrees) since the last update sent to Space3D are ignored. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Motion, meta = (ClampMin = "0.0"))
+  float MotionRotationEpsilon;
+  
+  /** Changes in scale smaller than this since the last update sent to Space3D are ignored. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Motion, meta = (ClampMin = "0.0"))
+  float MotionScaleEpsilon;
+  
+  /** Time between transform updates sent to Space3D while this object moves, in seconds; 0 = every frame. Use with MotionPrediction to keep fast objects smooth at low rates, e.g. 0.066 for 15 Hz. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Motion, meta = (ClampMin = "0.0"))
+  float MotionUpdateInterval;
+  
+  /** How the motion between updates is filled in. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Motion)
+  ESpace3DUnrealPrediction MotionPrediction;
+  
   USpace3DUnrealComponent(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
   virtual ~USpace3DUnrealComponent();
   
@@ -72,16 +184,28 @@ public:
   virtual bool RequiresScaleScale(); //default false, override if want true
   virtual void PreTick(); //optional
   virtual void UpdateS3DProps();
+  virtual bool IsPosedExternally() const; //true if something else (audio thread, trajectory, the component itself) sends the transform, and the subsystem should leave it alone
   
   //Don't override these
   virtual void OnRegister() override;
   virtual void OnUnregister() override;
-  virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction *ThisTickFunction) override;
+  /** Motion with Auto resolved. */
+  bool IsStaticAfterBeginPlay() const;
   
 protected:
-  uint64_t uuid; //Put uuid of object from Space3D here
+  /** Pass to FSpace3DUnrealCommandBuffer::Add when recording this component's object; it sets uuid once the object is created, unless the component has been unregistered since. */
+  TFunction<bool(uint64_t)> MakeOnCreated();
+  /** As above, for components with more than one object: Assign is given the component and the uuid instead. */
+  TFunction<bool(uint64_t)> MakeOnCreated(TFunction<void(USpace3DUnrealComponent*, uint64_t)> Assign);
+  
+  uint64_t uuid; //Put uuid of object from Space3D here; 0 until it has been created
   bool IntentionallyNotCreated;
   
 private:
-  uint64_t LastT;
+  friend class USpace3DUnrealSubsystem;
+  friend class USpace3DUnrealSplineTrajectory;
+  /** Bumped on unregister, so objects recorded before then are removed again when they are created. */
+  uint32 AddTicket;
+  /** Bound to a trajectory (FSpace3DUnrealTrajectories), which poses the object on the audio thread. */
+  bool bPosedByTrajectory;
 };
@@ -10,6 +10,97 @@
 
 #include "Space3DUnrealBlueprint.generated.h"
 
+/** Counters for the handoff of rendered frames from Space3D to the output submix, since the audio device was initialized. */
+USTRUCT(BlueprintType)
+struct SPACE3DUNREAL_API FSpace3DUnrealFrameStats
+{
+    GENERATED_BODY()
+    
+    /** Frames rendered by Space3D. */
+    UPROPERTY(BlueprintReadOnly, Category = "Custom")
+    int32 Rendered = 0;
+    
+    /** Frames played by the output. */
+    UPROPERTY(BlueprintReadOnly, Category = "Custom")
+    int32 Played = 0;
+    
+    /** Frames which were never played: skipped by the render worker, overflowed the queue, or skipped to catch up after a late frame. */
+    UPROPERTY(BlueprintReadOnly, Category = "Custom")
+    int32 Dropped = 0;
+    
+    /** Output buffers for which no frame was ready in time, and which were filled with silence. */
+    UPROPERTY(BlueprintReadOnly, Category = "Custom")
+    int32 Late = 0;
+    
+    /** Frames discarded because their audio time had already been played. */
+    UPROPERTY(BlueprintReadOnly, Category = "Custom")
+    int32 Duplicates = 0;
+    
+    /** Frames currently waiting to be played. */
+    UPROPERTY(BlueprintReadOnly, Category = "Custom")
+    int32 QueueDepth = 0;
+    
+    /** Output buffers in which the direct-path fallback stood in for Space3D (see FSpace3DUnrealOutputSettings::EnableDryFallback). */
+    UPROPERTY(BlueprintReadOnly, Category = "Custom")
+    int32 Fallback = 0;
+};
+
+/** State of the quality governor (see FSpace3DUnrealOutputSettings::EnableGovernor). */
+USTRUCT(BlueprintType)
+struct SPACE3DUNREAL_API FSpace3DUnrealGovernorStats
+{
+    GENERATED_BODY()
+    
+    /** Current quality tier: 0 is full quality, NumTiers - 1 the lowest. */
+    UPROPERTY(BlueprintReadOnly, Category = "Custom")
+    int32 Tier = 0;
+    
+    UPROPERTY(BlueprintReadOnly, Category = "Custom")
+    int32 NumTiers = 1;
+    
+    /** Smoothed share of the frame deadline spent in Space3D processing, in percent. */
+    UPROPERTY(BlueprintReadOnly, Category = "Custom")
+    float LoadPercent = 0.0f;
+    
+    /** 100 - LoadPercent; negative when frames are rendered slower than real time. */
+    UPROPERTY(BlueprintReadOnly, Category = "Custom")
+    float HeadroomPercent = 100.0f;
+    
+    /** Processing deadline of one frame. */
+    UPROPERTY(BlueprintReadOnly, Category = "Custom")
+    float DeadlineMs = 0.0f;
+    
+    /** Frames which took longer than the deadline to process. */
+    UPROPERTY(BlueprintReadOnly, Category = "Custom")
+    int32 Overruns = 0;
+    
+    UPROPERTY(BlueprintReadOnly, Category = "Custom")
+    int32 TierChanges = 0;
+};
+
+/** State of the estimate of the audio clock which component updates are timestamped with. */
+USTRUCT(BlueprintType)
+struct SPACE3DUNREAL_API FSpace3DUnrealClockStats
+{
+    GENERATED_BODY()
+    
+    /** Audio clock rate relative to the system clock, in parts per million. */
+    UPROPERTY(BlueprintReadOnly, Category = "Custom")
+    float DriftPpm = 0.0f;
+    
+    /** Smoothed size of the difference between the estimate and the audio clock as reported by the audio thread. */
+    UPROPERTY(BlueprintReadOnly, Category = "Custom")
+    float JitterMs = 0.0f;
+    
+    /** Difference at the last game frame; positive when the estimate was behind. */
+    UPROPERTY(BlueprintReadOnly, Category = "Custom")
+    float ErrorMs = 0.0f;
+    
+    /** Times the estimate was too far off and jumped to the audio clock, which resets every moving object. */
+    UPROPERTY(BlueprintReadOnly, Category = "Custom")
+    int32 Resyncs = 0;
+};
+
 UCLASS()
 class SPACE3DUNREAL_API UpdateParams : public UBlueprintFunctionLibrary
 {
@@ -38,5 +129,11 @@ class SPACE3DUNREAL_API UViewerBP : public UBlueprintFunctionLibrary
         static void EnableViewer(bool enable);
     UFUNCTION(BlueprintCallable, Category = "Custom", meta = (keywords = "Space3DPerformance"))
         static FString GetPerformance();
+    UFUNCTION(BlueprintCallable, Category = "Custom", meta = (keywords = "Space3DFrameStats"))
+        static FSpace3DUnrealFrameStats GetFrameStats();
+    UFUNCTION(BlueprintCallable, Category = "Custom", meta = (keywords = "Space3DGovernorStats"))
+        static FSpace3DUnrealGovernorStats GetGovernorStats();
+    UFUNCTION(BlueprintCallable, Category = "Custom", meta = (keywords = "Space3DClockStats"))
+        static FSpace3DUnrealClockStats GetClockStats();
 };
 
@@ -4,7 +4,7 @@
 
 #include "Space3DUnrealMeshes.generated.h"
 
-/** A mesh which audio can reflect off and diffract around. Attach this to an actor with a UStaticMeshComponent, or a USkinnedMeshComponent (including USkeletalMeshComponent) which has a UPhysicsAsset on its USkeletalMesh. */
+/** A mesh which audio can reflect off and diffract around. Attach this to an actor with a UStaticMeshComponent (including UInstancedStaticMeshComponent, where each instance becomes its own mesh), or a USkinnedMeshComponent (including USkeletalMeshComponent) which has a UPhysicsAsset on its USkeletalMesh. Static meshes are imported in the background and appear in Space3D a few frames after they are registered, nearest to the player first; those which never move can be merged with their neighbours and streamed in and out with the listener (see FSpace3DUnrealOutputSettings::StaticMeshCellSize and StaticMeshStreamRadius, both off by default). */
 UCLASS(BlueprintType, ClassGroup=Audio, EditInlineNew, meta=(BlueprintSpawnableComponent))
 class SPACE3DUNREAL_API USpace3DUnrealMesh : public USpace3DUnrealComponent
 {
@@ -14,26 +14,70 @@ public:
   UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", ClampMax = "255"))
   int MaterialIndex;
   
+  /** For a skinned mesh: make each body of the physics asset its own Space3D mesh, uploaded once in bone space and then only moved with its bone, instead of re-uploading every vertex of the posed mesh each frame. Far cheaper, and Space3D interpolates the bones' motion between frames. Read when the mesh is created. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite)
+  bool RigidSegments;
+  
+  /** For a static mesh: simplify the collision mesh to at most this many triangles before it is sent to Space3D, keeping open edges and sharp edges (see ProxyFeatureAngle) in place; 0 sends it as it is. Acoustics cannot resolve render-resolution detail, and ray tracing and geometry updates cost in proportion to the triangle count. Read when the mesh is created. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Proxy, meta = (ClampMin = "0"))
+  int ProxyTriangles;
+  
+  /** With ProxyTriangles: number of levels of detail, each with a quarter of the triangles of the one before. Read when the mesh is created. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Proxy, meta = (ClampMin = "1", ClampMax = "3"))
+  int ProxyLODs;
+  
+  /** With more than one ProxyLODs: distance from the player (in Unreal units) beyond which level of detail 1 is used, and twice this for level 2. Not applied to meshes with a MotionPrediction or posed by a trajectory, which keep the level they were created with. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Proxy, meta = (ClampMin = "0.0"))
+  float ProxyLODDistance;
+  
+  /** Edges whose faces meet at more than this angle, in degrees, are kept by the simplification, as sound diffracts around them. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Proxy, meta = (ClampMin = "0.0", ClampMax = "180.0"))
+  float ProxyFeatureAngle;
+  
   USpace3DUnrealMesh(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
-  ~USpace3DUnrealMesh();
   
   virtual void CreateS3DObject() override;
   virtual void DestroyS3DObject() override;
   virtual bool RequiresScaleScale() override;
   virtual void PreTick() override;
   virtual void UpdateS3DProps() override;
+  virtual bool IsPosedExternally() const override;
   
 private:
-  struct SegmentInfo {
-    int32 BodySetupIdx, BoneIndex;
-    TArray<FVector> Vertices;
+  /** Uploads static meshes, and swaps their levels of detail. */
+  friend class FSpace3DUnrealMeshLoader;
+
+  /** One body of the physics asset: a run of vertices which all move with one bone. */
+  struct FSkelSegment
+  {
+    int32 BoneIndex, FirstVertex, NumVertices, FirstIndex, NumIndices;
+    /** With RigidSegments: the segment's own Space3D mesh, and its bone transform as last sent. */
+    uint64_t uuid;
+    FTransform Sent;
+    bool bNew, bMoving;
   };
 
+  /** uuid of one instance of an instanced static mesh, or of the mesh itself. 0 if there is no such instance (e.g. the component re-registered with fewer instances). */
+  uint64_t GetInstanceUuid(int32 Instance) const { return !bInstanced ? uuid : InstanceUuids.IsValidIndex(Instance) ? InstanceUuids[Instance] : 0; }
+
+  /** Current pose of the physics asset's bodies, in component space. Each segment's vertices are transformed by its bone's matrix with a vector kernel, segments in parallel for large meshes. */
+  void PoseVertices(TArray<FVector>& Vertices) const;
+  /** With RigidSegments: records a transform for each segment whose bone has moved, like USpace3DUnrealSubsystem does for components. */
+  void PoseSegments();
+
   bool bStatic;
-  int LastMaterialIndex;
+  /** Created from a UInstancedStaticMeshComponent, its instances placed where they were at the time; uuid is then one of InstanceUuids. */
+  bool bInstanced;
+  TArray<uint64_t> InstanceUuids;
+  /** Merged into the mesh loader's cells with other static meshes; uuid (and InstanceUuids) are then the cells'. */
+  bool bMerged;
+  /** Created with RigidSegments; uuid is then the first segment's. */
+  bool bSegmented;
   int32 NumVertices, NumTriangles;
   USkinnedMeshComponent* SkelComponent;
   USkeletalMesh* SkelMesh;
   UPhysicsAsset* SkelPhysAsset;
-  TArray<SegmentInfo*> SkelSegments;
+  TArray<FSkelSegment> SkelSegments;
+  /** Vertices of all segments in bone space, one array per coordinate, in the same order as the mesh's vertices. */
+  TArray<float> SkelRestX, SkelRestY, SkelRestZ;
 };
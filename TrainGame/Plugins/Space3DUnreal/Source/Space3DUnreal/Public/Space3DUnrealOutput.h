@@ -190,7 +190,7 @@ struct SPACE3DUNREAL_API FSpace3DUnrealOutputSettings
   UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Misc, meta = (ClampMin = "0.000001"))
   float UnrealUnitScaleFactor;
   
-  /** Maximum time delay which can occur along any path, in units of frames. Paths whose length causes the audio delay along them to be longer than this value will be silenced. */
+  /** Maximum time delay which can occur along any path, in units of frames (see FrameLength). Paths whose length causes the audio delay along them to be longer than this value will be silenced. */
   UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Misc, meta = (ClampMin = "4", ClampMax = "512"))
   int MaxPathDelayFrames;
 
@@ -198,6 +198,86 @@ struct SPACE3DUNREAL_API FSpace3DUnrealOutputSettings
   UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Misc, meta = (ClampMin = "0", ClampMax = "3"))
   int SpeakersArrangeMode;
   
+  /** Number of samples Space3D processes per frame, or 0 to use the engine's audio buffer size. Audio is rebuffered between the two, so e.g. 128 or 256 lowers the latency from head / source movement to sound, while larger frames lower the processing cost per sample in heavy scenes. Best as a power of 2; mismatched sizes add up to one frame of latency. Can be changed at runtime (with a brief dropout). */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Misc, meta = (ClampMin = "0", ClampMax = "8192"))
+  int FrameLength;
+  
+  /** Sample rate Space3D renders at, or 0 to use the output device's rate. Path simulation and convolution cost scale with the sample rate, so e.g. 24000 or 32000 is much cheaper when the scene has little content above 10 kHz; source input and Space3D output are resampled (polyphase, about 90% of the lower Nyquist frequency) to and from the device rate. Can be changed at runtime (with a brief dropout). */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Misc, meta = (ClampMin = "0", ClampMax = "192000"))
+  int InternalSampleRate;
+  
+  /** Run Space3D processing on a dedicated high-priority thread instead of the audio render thread. This adds one buffer of latency, but variations in processing time of up to one buffer no longer cause underruns. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Threading)
+  bool ProcessOnRenderWorker;
+  
+  /** Number of rendered frames which may be buffered ahead of the output when processing on the render worker: 2 (double buffering) or 3 (triple buffering). More buffering rides out longer processing spikes, at the cost of extra latency until the output catches up again. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Threading, meta = (ClampMin = "2", ClampMax = "3", EditCondition = "ProcessOnRenderWorker"))
+  int RenderWorkerBuffers;
+  
+  /** Adapt path quality to the processing load. Each Space3D frame is timed against its deadline (FrameLength / sample rate); while processing is too slow, Order, RTRays, RTBranches and DiffNAngles are lowered step by step towards the Min values below, and raised back towards the values above once there is headroom again. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Governor)
+  bool EnableGovernor;
+  
+  /** Number of quality tiers from the values above (tier 0) to the Min values (the last tier). */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Governor, meta = (ClampMin = "2", ClampMax = "8", EditCondition = "EnableGovernor"))
+  int GovernorTiers;
+  
+  /** Share of the frame deadline spent in processing above which quality is lowered by one tier, e.g. 0.8. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Governor, meta = (ClampMin = "0.1", ClampMax = "2.0", EditCondition = "EnableGovernor"))
+  float GovernorDownLoad;
+  
+  /** Share of the frame deadline spent in processing (smoothed) below which quality is raised by one tier. Must be well below GovernorDownLoad, or the governor will oscillate between tiers. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Governor, meta = (ClampMin = "0.05", ClampMax = "1.0", EditCondition = "EnableGovernor"))
+  float GovernorUpLoad;
+  
+  /** Number of consecutive frames over GovernorDownLoad before quality is lowered. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Governor, meta = (ClampMin = "1", ClampMax = "100", EditCondition = "EnableGovernor"))
+  int GovernorDownFrames;
+  
+  /** Number of consecutive frames under GovernorUpLoad before quality is raised. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Governor, meta = (ClampMin = "1", ClampMax = "10000", EditCondition = "EnableGovernor"))
+  int GovernorUpFrames;
+  
+  /** Lowest Order the governor may go to. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Governor, meta = (ClampMin = "0", ClampMax = "6", EditCondition = "EnableGovernor"))
+  int MinOrder;
+  
+  /** Lowest RTRays the governor may go to. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Governor, meta = (ClampMin = "1000", ClampMax = "200000", EditCondition = "EnableGovernor"))
+  int MinRTRays;
+  
+  /** Lowest RTBranches the governor may go to. Must be a power of 2. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Governor, meta = (ClampMin = "1", ClampMax = "2048", EditCondition = "EnableGovernor"))
+  int MinRTBranches;
+  
+  /** Lowest DiffNAngles the governor may go to. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Governor, meta = (ClampMin = "0", ClampMax = "254", EditCondition = "EnableGovernor"))
+  int MinDiffNAngles;
+  
+  /** When Space3D cannot deliver its output in time (e.g. the GPU stalls on a shader compile or a large geometry upload), play a simplified direct-path-only rendering of the sources instead of silence: distance gain, propagation delay and panning to the heads, mics and speakers, computed on the CPU. Crossfades back to Space3D once it keeps up again. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Fallback)
+  bool EnableDryFallback;
+  
+  /** Watchdog deadline, in frame lengths: a Space3D processing call running longer than this counts as stalled, and the output fades to the fallback before the buffered frames run out. The fallback also takes over whenever the output runs out of frames. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Fallback, meta = (ClampMin = "0.5", ClampMax = "10.0", EditCondition = "EnableDryFallback"))
+  float DryFallbackDeadline;
+  
+  /** Duration of the crossfade back from the fallback to Space3D. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Fallback, meta = (ClampMin = "0.0", ClampMax = "1000.0", EditCondition = "EnableDryFallback"))
+  float DryFallbackCrossfadeMs;
+  
+  /** Time per game frame spent uploading static meshes to Space3D, in ms. Their collision geometry is extracted in the background as they are registered, and the finished meshes are then uploaded nearest to the player first, at least one per frame, until this is used up. Lower spreads a level's geometry over more frames; each upload holds up audio processing for as long as it takes. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Geometry, meta = (ClampMin = "0.0", ClampMax = "100.0"))
+  float MeshUploadBudgetMs;
+  
+  /** Static meshes which never move are merged into one Space3D mesh per cube of this size (in Unreal units) in world space, with their materials kept per vertex, so that a level's worth of small meshes becomes a handful of large ones. A cell is rebuilt when a mesh is added to it or removed from it. Meshes with a MotionPrediction, more than one ProxyLODs, or bound to a trajectory are kept on their own. 0 (the default) = no merging; about 5000 suits most levels. Read when meshes are created. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Geometry, meta = (ClampMin = "0.0"))
+  float StaticMeshCellSize;
+  
+  /** Merged cells of static meshes are only kept in Space3D within this distance (in Unreal units) of a head or mic, or of the player's camera if there are none; the rest are streamed out, and back in as they come within it, so that long levels cost no more to ray trace than short ones. Should be well beyond the distance over which paths matter. 0 (the default) = keep all of them; about 30000 suits most levels. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Geometry, meta = (ClampMin = "0.0"))
+  float StaticMeshStreamRadius;
+  
   
   FSpace3DUnrealOutputSettings()
     : Order(0)
@@ -252,6 +332,26 @@ struct SPACE3DUNREAL_API FSpace3DUnrealOutputSettings
     , UnrealUnitScaleFactor(0.01f)
     , MaxPathDelayFrames(256)
     , SpeakersArrangeMode(1)
+    , FrameLength(0)
+    , InternalSampleRate(0)
+    , ProcessOnRenderWorker(false)
+    , RenderWorkerBuffers(2)
+    , EnableGovernor(false)
+    , GovernorTiers(4)
+    , GovernorDownLoad(0.8f)
+    , GovernorUpLoad(0.5f)
+    , GovernorDownFrames(3)
+    , GovernorUpFrames(200)
+    , MinOrder(1)
+    , MinRTRays(10000)
+    , MinRTBranches(4)
+    , MinDiffNAngles(8)
+    , EnableDryFallback(true)
+    , DryFallbackDeadline(1.5f)
+    , DryFallbackCrossfadeMs(50.0f)
+    , MeshUploadBudgetMs(2.0f)
+    , StaticMeshCellSize(0.0f)
+    , StaticMeshStreamRadius(0.0f)
     {}
 };
 
@@ -23,11 +23,20 @@ public:
   UPROPERTY(EditAnywhere, BlueprintReadWrite)
   bool TestSound;
   
+  /** For a head attached to a VR camera: pose it from the HMD on the audio thread, just before each Space3D frame is rendered, instead of from this component's transform as of the last game frame. Cuts motion-to-sound latency. Ignored when no HMD is being tracked. Only one head can do this. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Tracking)
+  bool LateLatchHMDPose;
+  
+  /** How far ahead to extrapolate the late-latched HMD pose, in ms, to make up for output latency. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Tracking, meta = (ClampMin = "0.0", ClampMax = "50.0"))
+  float HMDPredictionMs;
+  
   USpace3DUnrealHead(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
   
   virtual void CreateS3DObject() override;
   virtual void DestroyS3DObject() override;
   virtual void UpdateS3DProps() override;
+  virtual bool IsPosedExternally() const override;
 };
 
 /** A mono, omnidirectional microphone in the virtual environment. */
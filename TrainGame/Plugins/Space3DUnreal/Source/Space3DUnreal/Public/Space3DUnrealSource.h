@@ -9,6 +9,22 @@
 
 #include "Space3DUnrealSource.generated.h"
 
+#define SPACE3DUNREAL_MAX_SOURCE_CHANNELS 8
+
+class FSpace3DUnrealResampler;
+
+/** How a multichannel source is mixed down to the mono signal Space3D spatializes. */
+UENUM(BlueprintType)
+enum class ESpace3DUnrealDownmix : uint8
+{
+  /** Sum of all channels (L+R for stereo). Keeps full level for content panned to one side, but can clip for correlated content. */
+  Sum,
+  /** Average of all channels ((L+R)/2 for stereo). Never clips; correlated content keeps its level. */
+  Mid,
+  /** Sum scaled by 1/sqrt(channels), which keeps the power of uncorrelated content (e.g. wide ambiences) unchanged. */
+  EnergyPreserving
+};
+
 UCLASS(editinlinenew, BlueprintType)
 class SPACE3DUNREAL_API USpace3DUnrealSourceSettings : public USpatializationPluginSourceSettingsBase
 {
@@ -35,6 +51,18 @@ public:
 
   UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings", meta = (ClampMin = "0.0", ClampMax = "1.0", UIMin = "0.0", UIMax = "1.0"))
   float ThresholdZero = 0.3f;
+
+  /** How stereo and multichannel (up to 8 channel) sounds are mixed down to mono before spatialization. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings")
+  ESpace3DUnrealDownmix Downmix = ESpace3DUnrealDownmix::Mid;
+  
+  /** Take the source out of Space3D's path processing while its input is silent. It stays in until its reflections have died away (MaxPathDelayFrames), and comes back on the first buffer with signal. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings")
+  bool GateSilence = true;
+  
+  /** Input level (RMS over one buffer, in dBFS) below which the source counts as silent. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings", meta = (ClampMin = "-140.0", ClampMax = "0.0", UIMin = "-120.0", UIMax = "-40.0", EditCondition = "GateSilence"))
+  float SilenceThresholdDb = -90.0f;
 };
 
 #if 0
@@ -90,7 +118,63 @@ public:
 	virtual void ProcessAudio(const FAudioPluginSourceInputData& InputData, FAudioPluginSourceOutputData& OutputData) override;
 	virtual void OnAllSourcesProcessed() override;
 private:
-  TArray<uint64_t> uuids;
+  /** Input for one source, staged by ProcessAudio and submitted in one batch by OnAllSourcesProcessed: audio and physics to the input FIFO. A source is only ever processed by one source worker per buffer, so its slot needs no locking. */
+  struct FStagedSource
+  {
+    TArray<float> Audio;
+    /** Audio resampled to Space3D's internal rate, and the resampler's history for this source. Unused when Space3D runs at the device rate. */
+    TArray<float> Resampled;
+    TArray<float> ResamplerHistory;
+    FVector Position;
+    FQuat Rotation;
+    uint64_t T;
+    ESpace3DUnrealDownmix Downmix;
+    bool bPending;
+    /** Input this buffer was below the silence threshold. */
+    bool bSilent;
+  };
+  
+  /** Per-slot state only touched on the audio render thread: the source's Space3D properties, kept so that the silence gate can re-create it, and the gate itself. While the gate is closed the slot is in use but has no Space3D source (key 0). */
+  struct FSourceProps
+  {
+    bool bInUse;
+    bool bHasSettings;
+    float Volume;
+    int32 DirType;
+    float DirBeamWidth, DirCosMixFactor, DirUnused;
+    float ThresholdFull, ThresholdZero;
+    bool bGateSilence;
+    /** Mean square input level below which a buffer is silent. */
+    float SilenceLevel;
+    /** Silent input since the last buffer with signal, in device samples. */
+    int64 SilentSamples;
+    /** AudioComponentUserID of the source's audio component, under which a trajectory may be bound to it. */
+    FName TrajectoryUserId;
+  };
+
+  void SubmitStagedSources();
+  /** Opens or closes each slot's silence gate according to this buffer's input, giving it a source key or taking it away. */
+  void UpdateSilenceGates();
+  /** Gives the slot a new source key. Whoever runs Space3D adds the Space3D source, with the slot's properties, when it gets to the first push carrying the key. */
+  void CreateS3DSource(int32 Slot);
+  /** Space3D frame length requested by the output preset, or the engine buffer size if none. */
+  int32 GetWantedFrameLength() const;
+  /** Space3D sample rate requested by the output preset, or the device rate if none. */
+  float GetWantedSampleRate() const;
+  /** Sets Space3D's frame length and sample rate, and sets up rebuffering and resampling between them and the engine's. */
+  void ConfigureRendering();
+
+  /** Per slot, the key of the Space3D source it should have (see FSpace3DUnrealSourceState); 0 = none. */
+  TArray<uint64_t> Keys;
+  uint64_t NextKey;
+  /** The last push carried a source, which the render side may still have to remove. */
+  bool bSourcesLive;
   TArray<uint64_t> LastTs;
+  TArray<FStagedSource> Staged;
+  TArray<FSourceProps> Props;
   int32 NumActiveSources;
+  int32 BufferLength;
+  float SampleRate;
+  /** Device rate to Space3D's internal rate. The phase is shared by all sources and advanced once per buffer in OnAllSourcesProcessed. */
+  TUniquePtr<FSpace3DUnrealResampler> InputResampler;
 };
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "Space3DUnreal.h"
+
+#include "CoreMinimal.h"
+#include "Engine/EngineBaseTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+
+#include "Space3DUnrealSubsystem.generated.h"
+
+class USpace3DUnrealSubsystem;
+
+/** Ticks USpace3DUnrealSubsystem once per frame, after physics. */
+USTRUCT()
+struct FSpace3DUnrealTickFunction : public FTickFunction
+{
+  GENERATED_BODY()
+
+  USpace3DUnrealSubsystem* Subsystem = nullptr;
+
+  virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+  virtual FString DiagnosticMessage() override;
+};
+
+template<>
+struct TStructOpsTypeTraits<FSpace3DUnrealTickFunction> : public TStructOpsTypeTraitsBase2<FSpace3DUnrealTickFunction>
+{
+  enum { WithCopy = false };
+};
+
+/**
+Updates all of a world's Space3D components together, instead of each component ticking on its own.
+
+Once per frame, after physics, every registered component's PreTick() runs, static meshes which FSpace3DUnrealMeshLoader has finished extracting are uploaded within the frame's budget, then the transforms of all components are gathered into contiguous arrays (in parallel), and finally all physics updates and property changes are recorded in the command buffer (FSpace3DUnrealCommandBuffer) and committed to Space3D, with whatever else was recorded this frame, under a single API lock. All components share one smoothed estimate of the audio clock (FSpace3DUnrealClock).
+
+Only transforms which changed by more than the component's motion epsilons since they were last sent are sent again; an object which has just stopped gets one PhysReset, so Space3D does not keep extrapolating its motion, and then nothing until it moves again. Components with a MotionUpdateInterval are only looked at that often, and those with a MotionPrediction send their velocity to FSpace3DUnrealPredictor instead of a PhysUpdate. Components which are static after BeginPlay are dropped once their first update has been committed.
+*/
+UCLASS()
+class SPACE3DUNREAL_API USpace3DUnrealSubsystem : public UWorldSubsystem
+{
+  GENERATED_BODY()
+
+public:
+  virtual void Deinitialize() override;
+
+  /** Called by components when they create / destroy their Space3D object. */
+  void Register(USpace3DUnrealComponent* Component);
+  void Unregister(USpace3DUnrealComponent* Component);
+
+  void Tick(float DeltaTime);
+
+private:
+  FSpace3DUnrealTickFunction TickFunction;
+
+  enum class EAction : uint8 { None, Update, Reset, Predict };
+
+  /** What was last sent to Space3D for a component. */
+  struct FTrackState
+  {
+    FVector Position, Scale;
+    FQuat Rotation;
+    /** Newly registered, so the first update must be a PhysReset. */
+    bool bNew;
+    /** Last sent as a PhysUpdate or prediction, so its motion is being extrapolated. */
+    bool bMoving;
+    /** In FSpace3DUnrealPredictor, which poses it on the audio side from the last sample. */
+    bool bPredicted;
+    /** Velocity in the last prediction sample. */
+    FVector Velocity;
+    /** Time the state was last sent, and the earliest time the transform is read again (MotionUpdateInterval). */
+    uint64_t SampleT, NextT;
+  };
+
+  /** Where the registered heads and mics are, or else the player's camera, for the order in which static meshes are uploaded and which cells are streamed in. */
+  void GetListenerLocations(TArray<FVector>& OutLocations) const;
+
+  /** Sends the component's transform along with its velocity to the predictor, and updates State. */
+  static void Predict(USpace3DUnrealComponent* Component, FTrackState& State, uint64_t T, const FVector& Position, const FQuat& Rotation, const FVector& Scale3D);
+
+  /** Registered components, and one FTrackState each. */
+  TArray<USpace3DUnrealComponent*> Components;
+  TArray<FTrackState> States;
+  /** Registered heads and mics, which are kept here even once they are static. */
+  TArray<USpace3DUnrealComponent*> Sinks;
+
+  /** Transforms gathered this frame, and what to send for each, one entry per component. */
+  TArray<uint64_t> Uuids;
+  TArray<FVector> Positions, Scales;
+  TArray<FQuat> Rotations;
+  TArray<EAction> Actions;
+  TArray<FVector> ListenerLocations;
+};
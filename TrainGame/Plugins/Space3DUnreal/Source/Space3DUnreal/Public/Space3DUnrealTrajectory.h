@@ -0,0 +1,89 @@
+#pragma once
+
+#include "Space3DUnreal.h"
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+
+#include "Space3DUnrealTrajectory.generated.h"
+
+class USplineComponent;
+class UAudioComponent;
+
+/**
+Moves its actor along a spline with a known speed profile, and has everything audible on the actor posed from that motion on the audio side, at the exact time of each audio frame, instead of from game-thread updates.
+
+The spline, distance along it and speed profile are registered once (and again whenever SetSpline or SetMotion is called). The actor's Space3D components are then PhysReset from Space3D's physics callback, and its audio components' positions replaced at the time of each buffer, so moving sources and geometry need no per-frame updates and have exact Doppler shift. Each component keeps the offset from the actor it had when it was bound. Audio components are matched by their AudioComponentUserID, which is generated if they have none when this component is registered, before the actor's sounds auto-activate.
+*/
+UCLASS(BlueprintType, ClassGroup=Audio, meta=(BlueprintSpawnableComponent))
+class SPACE3DUNREAL_API USpace3DUnrealSplineTrajectory : public UActorComponent
+{
+  GENERATED_BODY()
+
+public:
+  /** Actor whose first spline component is followed. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Trajectory)
+  AActor* SplineActor;
+
+  /** Distance along the spline at BeginPlay, in Unreal units. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Trajectory)
+  float StartDistance;
+
+  /** Speed along the spline at BeginPlay, in Unreal units per second; negative to go backwards. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Trajectory)
+  float StartSpeed;
+
+  /** Speed approached from StartSpeed at Acceleration, and kept once reached. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Trajectory)
+  float TargetSpeed;
+
+  /** In Unreal units per second squared; 0 keeps StartSpeed. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Trajectory, meta = (ClampMin = "0.0"))
+  float Acceleration;
+
+  /** Move the actor along the trajectory every frame. Turn off if something else moves it along the same path. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Trajectory)
+  bool DriveOwner;
+
+  USpace3DUnrealSplineTrajectory(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
+
+  virtual void OnRegister() override;
+  virtual void BeginPlay() override;
+  virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+  virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+  /** Follows the first spline component of NewSplineActor from now on, keeping the current motion. */
+  UFUNCTION(BlueprintCallable, Category = Trajectory)
+  void SetSpline(AActor* NewSplineActor);
+
+  /** Restarts the motion from Distance and Speed now. */
+  UFUNCTION(BlueprintCallable, Category = Trajectory)
+  void SetMotion(float Distance, float Speed, float NewTargetSpeed, float NewAcceleration);
+
+  /** Current distance along the spline and speed, as of this frame's audio time. */
+  UFUNCTION(BlueprintCallable, BlueprintPure, Category = Trajectory)
+  float GetDistance() const;
+  UFUNCTION(BlueprintCallable, BlueprintPure, Category = Trajectory)
+  float GetSpeed() const;
+
+private:
+  /** Audio time of this game frame, on the same clock as component updates. */
+  static uint64_t Now();
+  USplineComponent* FindSpline() const;
+  /** Adds the trajectory, if there is a spline to follow. */
+  bool Register();
+  /** Moves the actor to where the trajectory is this frame (if DriveOwner), then binds its components. */
+  void Follow();
+  /** Binds the actor's Space3D components which have been created since the last call, and its audio components. */
+  void BindComponents();
+  /** Gives Audio a user ID to be bound under, if it has none. Returns false if it already had one. */
+  bool AssignUserID(UAudioComponent* Audio) const;
+  /** Offset of Component from the actor, as bound. */
+  FTransform GetOffset(const USceneComponent* Component) const;
+
+  /** In FSpace3DUnrealTrajectories; 0 while not registered. */
+  int32 Handle;
+  double Distance0, Speed0, TargetSpeed0, Acceleration0;
+  uint64_t T0;
+  TArray<FName> BoundSources;
+};
@@ -34,6 +34,7 @@ public class Space3DUnreal : ModuleRules
 				"AudioExtensions",
 				"CoreUObject",
 				"Engine",
+				"HeadMountedDisplay",
 				"Projects",
 				"Slate",
 				"SlateCore",
@@ -42,6 +43,14 @@ public class Space3DUnreal : ModuleRules
 			}
 			);
 		
+		if(Target.bBuildEditor)
+		{
+			//Cooked acoustic geometry is cached in the DDC while developing
+			PrivateDependencyModuleNames.Add("DerivedDataCache");
+			//The cook commandlet finds the project's maps
+			PrivateDependencyModuleNames.Add("AssetRegistry");
+		}
+		
 		
 		DynamicallyLoadedModuleNames.AddRange(
 			new string[]